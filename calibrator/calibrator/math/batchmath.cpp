@@ -0,0 +1,216 @@
+#include <algorithm>
+#include <cmath>
+
+#include <ql/mathconstants.hpp>
+
+#include <calibrator/math/batchmath.hpp>
+
+#if defined( CALIBRATOR_VECTORISED_MATH )
+#include <immintrin.h>
+#endif
+
+namespace HJCALIBRATOR
+{
+	namespace
+	{
+		// Every operation of the kernels is on a pack of lanes, whose type is that of the instruction set
+		// of the build. Without any, the values are those of the standard library.
+
+	#if defined( __AVX512F__ )
+		struct Avx512Pack
+		{
+			typedef __mmask8 Mask;
+			static const Size lanes = 8;
+
+			__m512d v;
+
+			Avx512Pack( __m512d x ) : v( x ) {}
+			Avx512Pack( Real x ) : v( _mm512_set1_pd( x ) ) {}
+
+			static Avx512Pack load( const Real* x ) { return _mm512_loadu_pd( x ); }
+			static bool any( Mask m ) { return m != 0; }
+			void store( Real* x ) const { _mm512_storeu_pd( x, v ); }
+
+			friend Avx512Pack operator+( Avx512Pack a, Avx512Pack b ) { return _mm512_add_pd( a.v, b.v ); }
+			friend Avx512Pack operator-( Avx512Pack a, Avx512Pack b ) { return _mm512_sub_pd( a.v, b.v ); }
+			friend Avx512Pack operator*( Avx512Pack a, Avx512Pack b ) { return _mm512_mul_pd( a.v, b.v ); }
+			friend Avx512Pack operator/( Avx512Pack a, Avx512Pack b ) { return _mm512_div_pd( a.v, b.v ); }
+
+			friend Mask operator<( Avx512Pack a, Avx512Pack b ) { return _mm512_cmp_pd_mask( a.v, b.v, _CMP_LT_OQ ); }
+
+			friend Avx512Pack clamp( Avx512Pack x, Avx512Pack lower, Avx512Pack upper )
+			{
+				return _mm512_min_pd( upper.v, _mm512_max_pd( lower.v, x.v ) );
+			}
+
+			friend Avx512Pack abs( Avx512Pack x ) { return _mm512_abs_pd( x.v ); }
+			friend Avx512Pack floor( Avx512Pack x ) { return _mm512_roundscale_pd( x.v, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC ); }
+
+			// the integer k + 1023 lands in the low bits of the mantissa, and is shifted into the exponent
+			friend Avx512Pack pow2( Avx512Pack k )
+			{
+				__m512d biased = _mm512_add_pd( k.v, _mm512_set1_pd( 4503599627371519.0 ) );
+				return _mm512_castsi512_pd( _mm512_slli_epi64( _mm512_castpd_si512( biased ), 52 ) );
+			}
+
+			friend Avx512Pack select( Mask m, Avx512Pack a, Avx512Pack b ) { return _mm512_mask_blend_pd( m, b.v, a.v ); }
+		};
+
+		typedef Avx512Pack Pack;
+	#elif defined( __AVX2__ )
+		struct Avx2Pack
+		{
+			typedef __m256d Mask;
+			static const Size lanes = 4;
+
+			__m256d v;
+
+			Avx2Pack( __m256d x ) : v( x ) {}
+			Avx2Pack( Real x ) : v( _mm256_set1_pd( x ) ) {}
+
+			static Avx2Pack load( const Real* x ) { return _mm256_loadu_pd( x ); }
+			static bool any( Mask m ) { return _mm256_movemask_pd( m ) != 0; }
+			void store( Real* x ) const { _mm256_storeu_pd( x, v ); }
+
+			friend Avx2Pack operator+( Avx2Pack a, Avx2Pack b ) { return _mm256_add_pd( a.v, b.v ); }
+			friend Avx2Pack operator-( Avx2Pack a, Avx2Pack b ) { return _mm256_sub_pd( a.v, b.v ); }
+			friend Avx2Pack operator*( Avx2Pack a, Avx2Pack b ) { return _mm256_mul_pd( a.v, b.v ); }
+			friend Avx2Pack operator/( Avx2Pack a, Avx2Pack b ) { return _mm256_div_pd( a.v, b.v ); }
+
+			friend Mask operator<( Avx2Pack a, Avx2Pack b ) { return _mm256_cmp_pd( a.v, b.v, _CMP_LT_OQ ); }
+
+			friend Avx2Pack clamp( Avx2Pack x, Avx2Pack lower, Avx2Pack upper )
+			{
+				return _mm256_min_pd( upper.v, _mm256_max_pd( lower.v, x.v ) );
+			}
+
+			friend Avx2Pack abs( Avx2Pack x ) { return _mm256_andnot_pd( _mm256_set1_pd( -0.0 ), x.v ); }
+			friend Avx2Pack floor( Avx2Pack x ) { return _mm256_floor_pd( x.v ); }
+
+			friend Avx2Pack pow2( Avx2Pack k )
+			{
+				__m256d biased = _mm256_add_pd( k.v, _mm256_set1_pd( 4503599627371519.0 ) );
+				return _mm256_castsi256_pd( _mm256_slli_epi64( _mm256_castpd_si256( biased ), 52 ) );
+			}
+
+			friend Avx2Pack select( Mask m, Avx2Pack a, Avx2Pack b ) { return _mm256_blendv_pd( b.v, a.v, m ); }
+		};
+
+		typedef Avx2Pack Pack;
+	#endif
+
+	#if defined( CALIBRATOR_VECTORISED_MATH )
+		Pack expKernel( Pack x )
+		{
+			const Real lower = -708.0, upper = 709.0;
+
+			// ln 2 split so that k C1 is exact
+			const Real C1 = 6.93145751953125E-1;
+			const Real C2 = 1.42860682030941723212E-6;
+
+			Pack y = clamp( x, lower, upper );
+			Pack k = floor( y * Pack( M_LOG2E ) + Pack( 0.5 ) );
+			Pack r = y - k * Pack( C1 ) - k * Pack( C2 );
+			Pack rr = r * r;
+
+			Pack p = r * ((Pack( 1.26177193074810590878E-4 ) * rr + Pack( 3.02994407707441961300E-2 )) * rr
+						  + Pack( 9.99999999999999999910E-1 ));
+			Pack q = ((Pack( 3.00198505138664455042E-6 ) * rr + Pack( 2.52448340349684104192E-3 )) * rr
+					  + Pack( 2.27265548208155028766E-1 )) * rr + Pack( 2.00000000000000000009E0 );
+
+			Pack e = (Pack( 1.0 ) + Pack( 2.0 ) * p / (q - p)) * pow2( k );
+
+			e = select( x < Pack( lower ), Pack( 0.0 ), e );
+			return select( Pack( upper ) < x, Pack( HUGE_VAL ), e );
+		}
+
+		Pack normalCdfKernel( Pack x )
+		{
+			const Real tail = 37.0, split = 4.0;
+			const Real sqrt2Pi = 2.50662827463100050242;
+
+			Pack z = abs( x );
+			Pack density = expKernel( Pack( -0.5 ) * z * z );
+
+			Pack numerator = ((((((Pack( 3.52624965998911E-02 ) * z + Pack( 0.700383064443688 )) * z
+								   + Pack( 6.37396220353165 )) * z + Pack( 33.912866078383 )) * z
+								 + Pack( 112.079291497871 )) * z + Pack( 221.213596169931 )) * z
+							   + Pack( 220.206867912376 ));
+			Pack denominator = (((((((Pack( 8.83883476483184E-02 ) * z + Pack( 1.75566716318264 )) * z
+									 + Pack( 16.064177579207 )) * z + Pack( 86.7807322029461 )) * z
+								   + Pack( 296.564248779674 )) * z + Pack( 637.333633378831 )) * z
+								 + Pack( 793.826512519948 )) * z + Pack( 440.413735824752 ));
+			Pack lowerTail = density * numerator / denominator;
+
+			// Hart's approximation loses relative accuracy in the tail, where the continued fraction of the Mills
+			// ratio 32 levels deep is exact to the last digits. Its convergents a/b are computed forward, so that
+			// there is a single division, and only when some lane needs them.
+			Pack::Mask far = Pack( split ) < z;
+			if ( Pack::any( far ) )
+			{
+				Pack a0 = 1.0, a1 = z;
+				Pack b0 = 0.0, b1 = 1.0;
+				for ( int k = 1; k <= 32; k++ )
+				{
+					Pack a2 = z * a1 + Pack( Real( k ) ) * a0;
+					Pack b2 = z * b1 + Pack( Real( k ) ) * b0;
+
+					a0 = a1;
+					a1 = a2;
+					b0 = b1;
+					b1 = b2;
+				}
+
+				lowerTail = select( far, density * b1 / (a1 * Pack( sqrt2Pi )), lowerTail );
+			}
+
+			lowerTail = select( Pack( tail ) < z, Pack( 0.0 ), lowerTail );
+
+			return select( Pack( 0.0 ) < x, Pack( 1.0 ) - lowerTail, lowerTail );
+		}
+
+		// the remainder of the strip goes through a padded pack
+		template <Pack (*Kernel)( Pack )>
+		void apply( const Real* x, Real* result, Size n )
+		{
+			Size k = 0;
+			for ( ; k + Pack::lanes <= n; k += Pack::lanes )
+			{
+				Kernel( Pack::load( x + k ) ).store( result + k );
+			}
+
+			if ( k < n )
+			{
+				Real lanes[Pack::lanes] = {};
+				std::copy( x + k, x + n, lanes );
+				Kernel( Pack::load( lanes ) ).store( lanes );
+				std::copy( lanes, lanes + (n - k), result + k );
+			}
+		}
+	#endif
+	}
+
+	void batchExp( const Real* x, Real* result, Size n )
+	{
+	#if defined( CALIBRATOR_VECTORISED_MATH )
+		apply<expKernel>( x, result, n );
+	#else
+		for ( Size k = 0; k < n; k++ )
+		{
+			result[k] = std::exp( x[k] );
+		}
+	#endif
+	}
+
+	void batchNormalCdf( const Real* x, Real* result, Size n )
+	{
+	#if defined( CALIBRATOR_VECTORISED_MATH )
+		apply<normalCdfKernel>( x, result, n );
+	#else
+		for ( Size k = 0; k < n; k++ )
+		{
+			result[k] = 0.5 * std::erfc( -x[k] * M_SQRT1_2 );
+		}
+	#endif
+	}
+}
@@ -0,0 +1,30 @@
+#ifndef CALIBRATOR_MATH_BATCHMATH_HPP
+#define CALIBRATOR_MATH_BATCHMATH_HPP
+
+#include <calibrator/global.hpp>
+
+// defined when the batches run on vector lanes, otherwise the callers take std::exp in place
+#if defined( __AVX512F__ ) || defined( __AVX2__ )
+#define CALIBRATOR_VECTORISED_MATH
+#endif
+
+namespace HJCALIBRATOR
+{
+	//! Exponential of n values, 8 lanes at a time with AVX-512, 4 with AVX2
+	/*! Cephes reduction \f$ x = k\ln 2 + r \f$ with a (2,3) rational approximation of \f$ e^r \f$,
+	so that every lane follows the same branch-free sequence. The relative error to std::exp is
+	below 4e-16 over [-708, 709], the result being 0 below and +inf above. A build without either
+	instruction set falls back to std::exp. The input may be the result buffer.
+	*/
+	void batchExp( const Real* x, Real* result, Size n );
+
+	//! Standard normal cumulative distribution of n values, vectorised as batchExp
+	/*! Hart's rational approximation for \f$ |x| \le 4 \f$ and the continued fraction of the Mills
+	ratio beyond, blended per lane. The absolute error to 0.5 erfc(-x/sqrt(2)) is below 3e-16, and the
+	relative error below 3e-13 over [-37, 0], the result being exactly 0 below -37 and 1 above 37.
+	The fallback is 0.5 erfc(-x/sqrt(2)). The input may be the result buffer.
+	*/
+	void batchNormalCdf( const Real* x, Real* result, Size n );
+}
+
+#endif // !CALIBRATOR_MATH_BATCHMATH_HPP
@@ -0,0 +1,32 @@
+#include <ql/math/integrals/gaussianquadratures.hpp>
+
+#include <calibrator/math/integrals/gausslegendreintegral.hpp>
+
+namespace HJCALIBRATOR
+{
+	GaussLegendreIntegral::GaussLegendreIntegral( Size order )
+		: Integrator( QL_MAX_REAL, order )
+	{
+		QL_REQUIRE( order > 0, "The order of the Gauss-Legendre rule must be positive." );
+
+		GaussLegendreIntegration rule( order );
+		x_ = rule.x();
+		w_ = rule.weights();
+	}
+
+	Real GaussLegendreIntegral::integrate( const boost::function<Real( Real )>& f, Real a, Real b ) const
+	{
+		Real center = (a + b) / 2;
+		Real halfWidth = (b - a) / 2;
+
+		Real sum = 0;
+		for ( Size k = 0; k < x_.size(); k++ )
+		{
+			sum += w_[k] * f( center + halfWidth * x_[k] );
+		}
+
+		increaseNumberOfEvaluations( x_.size() );
+
+		return halfWidth * sum;
+	}
+}
@@ -0,0 +1,35 @@
+#ifndef CALIBRATOR_MATH_INTEGRALS_GAUSSLEGENDREINTEGRAL_HPP
+#define CALIBRATOR_MATH_INTEGRALS_GAUSSLEGENDREINTEGRAL_HPP
+
+#include <ql/math/array.hpp>
+#include <ql/math/integrals/integral.hpp>
+
+#include <calibrator/global.hpp>
+
+namespace HJCALIBRATOR
+{
+	//! Fixed order Gauss-Legendre rule on [a, b]
+	/*! The cost is exactly n function evaluations per integral, regardless of the integrand,
+	which gives a deterministic latency.
+	*/
+	class GaussLegendreIntegral : public Integrator
+	{
+	public:
+		explicit GaussLegendreIntegral( Size order );
+
+		Size order() const { return x_.size(); }
+
+		//! Abscissas and weights on [-1, 1]
+		const Array& x() const { return x_; }
+		const Array& weights() const { return w_; }
+
+	protected:
+		virtual Real integrate( const boost::function<Real( Real )>& f, Real a, Real b ) const override;
+
+	private:
+		Array x_;
+		Array w_;
+	};
+}
+
+#endif // !CALIBRATOR_MATH_INTEGRALS_GAUSSLEGENDREINTEGRAL_HPP
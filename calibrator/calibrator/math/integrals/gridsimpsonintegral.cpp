@@ -0,0 +1,41 @@
+#include <algorithm>
+
+#include <calibrator/math/integrals/gridsimpsonintegral.hpp>
+
+namespace HJCALIBRATOR
+{
+	GridSimpsonIntegral::GridSimpsonIntegral( const std::vector<Real>& grid )
+		: Integrator( QL_MAX_REAL, 2 * grid.size() + 3 )
+		, grid_( grid )
+	{
+		std::sort( grid_.begin(), grid_.end() );
+		grid_.erase( std::unique( grid_.begin(), grid_.end() ), grid_.end() );
+	}
+
+	Real GridSimpsonIntegral::integrate( const boost::function<Real( Real )>& f, Real a, Real b ) const
+	{
+		std::vector<Real>::const_iterator it = std::upper_bound( grid_.begin(), grid_.end(), a );
+		std::vector<Real>::const_iterator last = std::lower_bound( grid_.begin(), grid_.end(), b );
+
+		Real begin = a;
+		Real fbegin = f( a );
+		Real sum = 0;
+		Size evaluations = 1;
+
+		while ( begin < b )
+		{
+			Real end = it < last ? *it++ : b;
+			Real fend = f( end );
+
+			sum += (end - begin) * (fbegin + 4 * f( (begin + end) / 2 ) + fend) / 6;
+			evaluations += 2;
+
+			begin = end;
+			fbegin = fend;
+		}
+
+		increaseNumberOfEvaluations( evaluations );
+
+		return sum;
+	}
+}
@@ -0,0 +1,32 @@
+#ifndef CALIBRATOR_MATH_INTEGRALS_GRIDSIMPSONINTEGRAL_HPP
+#define CALIBRATOR_MATH_INTEGRALS_GRIDSIMPSONINTEGRAL_HPP
+
+#include <vector>
+
+#include <ql/math/integrals/integral.hpp>
+
+#include <calibrator/global.hpp>
+
+namespace HJCALIBRATOR
+{
+	//! Composite Simpson rule on a given time grid
+	/*! The interval [a, b] is cut at the grid points falling inside it, and each piece is
+	integrated with the Simpson rule. Putting the parameter nodes on the grid keeps the
+	integrand smooth on every piece.
+	*/
+	class GridSimpsonIntegral : public Integrator
+	{
+	public:
+		explicit GridSimpsonIntegral( const std::vector<Real>& grid );
+
+		const std::vector<Real>& grid() const { return grid_; }
+
+	protected:
+		virtual Real integrate( const boost::function<Real( Real )>& f, Real a, Real b ) const override;
+
+	private:
+		std::vector<Real> grid_;
+	};
+}
+
+#endif // !CALIBRATOR_MATH_INTEGRALS_GRIDSIMPSONINTEGRAL_HPP
@@ -0,0 +1,67 @@
+#include <type_traits>
+#include <typeinfo>
+
+#include <ql/math/integrals/kronrodintegral.hpp>
+#include <ql/math/integrals/segmentintegral.hpp>
+#include <ql/math/integrals/simpsonintegral.hpp>
+
+#include <calibrator/math/integrals/integratorcopy.hpp>
+#include <calibrator/math/integrals/gausslegendreintegral.hpp>
+#include <calibrator/math/integrals/gridsimpsonintegral.hpp>
+
+namespace HJCALIBRATOR
+{
+	namespace
+	{
+		// calls visitor( rule ) with the integrator cast to its exact type, returns false for an unknown type
+		template <class Visitor>
+		bool visitRule( const Integrator& integrator, const Visitor& visitor )
+		{
+			const std::type_info& type = typeid(integrator);
+
+			if ( type == typeid(GaussKronrodAdaptive) )
+				visitor( static_cast<const GaussKronrodAdaptive&>( integrator ) );
+			else if ( type == typeid(GaussKronrodNonAdaptive) )
+				visitor( static_cast<const GaussKronrodNonAdaptive&>( integrator ) );
+			else if ( type == typeid(SimpsonIntegral) )
+				visitor( static_cast<const SimpsonIntegral&>( integrator ) );
+			else if ( type == typeid(SegmentIntegral) )
+				visitor( static_cast<const SegmentIntegral&>( integrator ) );
+			else if ( type == typeid(GaussLegendreIntegral) )
+				visitor( static_cast<const GaussLegendreIntegral&>( integrator ) );
+			else if ( type == typeid(GridSimpsonIntegral) )
+				visitor( static_cast<const GridSimpsonIntegral&>( integrator ) );
+			else
+				return false;
+
+			return true;
+		}
+	}
+
+	shared_ptr<Integrator> copyIntegrator( const Integrator& integrator )
+	{
+		shared_ptr<Integrator> copy;
+
+		visitRule( integrator, [&]( const auto& rule )
+		{
+			copy.reset( new std::decay_t<decltype(rule)>( rule ) );
+		} );
+
+		return copy;
+	}
+
+	Real integrateOnCopy( const Integrator& integrator, const boost::function<Real( Real )>& f, Real a, Real b )
+	{
+		Real result = 0;
+
+		bool known = visitRule( integrator, [&]( const auto& rule )
+		{
+			std::decay_t<decltype(rule)> copy( rule );
+			result = copy( f, a, b );
+		} );
+
+		QL_REQUIRE( known, "The integrator " << typeid(integrator).name() << " cannot be copied." );
+
+		return result;
+	}
+}
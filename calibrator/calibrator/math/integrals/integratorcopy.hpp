@@ -0,0 +1,22 @@
+#ifndef CALIBRATOR_MATH_INTEGRALS_INTEGRATORCOPY_HPP
+#define CALIBRATOR_MATH_INTEGRALS_INTEGRATORCOPY_HPP
+
+#include <ql/math/integrals/integral.hpp>
+
+#include <calibrator/global.hpp>
+
+namespace HJCALIBRATOR
+{
+	/* A QuantLib integrator records the number of evaluations and the error of its last call in the
+	instance, so that concurrent calls on one instance race. The functions below make copies of the
+	rules of QuantLib and of this library, recognised by their exact type. */
+
+	//! Copy of the integrator, or null if its type is not one of the known rules
+	shared_ptr<Integrator> copyIntegrator( const Integrator& integrator );
+
+	//! Integral of f over [a, b] by a copy of the integrator made on the stack for the call
+	/*! The integrator has to be one of the rules copyIntegrator knows. */
+	Real integrateOnCopy( const Integrator& integrator, const boost::function<Real( Real )>& f, Real a, Real b );
+}
+
+#endif // !CALIBRATOR_MATH_INTEGRALS_INTEGRATORCOPY_HPP
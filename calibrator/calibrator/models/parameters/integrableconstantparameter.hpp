@@ -0,0 +1,46 @@
+#ifndef CALIBRATOR_MODELS_PARAMETERS_INTEGRABLECONSTANTPARAMETER_HPP
+#define CALIBRATOR_MODELS_PARAMETERS_INTEGRABLECONSTANTPARAMETER_HPP
+
+#include <calibrator/models/parameters/integrableparameter.hpp>
+
+namespace HJCALIBRATOR
+{
+	//! Constant parameter with its integral
+	class IntegrableConstantParameter : public IntegrableParameter
+	{
+		friend class ParameterSnapshot;
+
+	private:
+		class Impl : public IntegrableParameter::Impl
+		{
+		public:
+			Real value( const Array& params, Time ) const
+			{
+				return params[0];
+			}
+
+			Real integral( const Array& params, Time t0, Time t1 ) const
+			{
+				return params[0] * (t1 - t0);
+			}
+		};
+
+	public:
+		IntegrableConstantParameter( const Constraint& constraint = NoConstraint() )
+			: IntegrableParameter( 1,
+								   shared_ptr<IntegrableParameter::Impl>( new IntegrableConstantParameter::Impl ),
+								   constraint )
+		{}
+
+		IntegrableConstantParameter( Real value,
+									 const Constraint& constraint = NoConstraint() )
+			: IntegrableConstantParameter( constraint )
+		{
+			params_[0] = value;
+			QL_REQUIRE( testParams( params_ ),
+						value << ": invalid value" );
+		}
+	};
+}
+
+#endif // !CALIBRATOR_MODELS_PARAMETERS_INTEGRABLECONSTANTPARAMETER_HPP
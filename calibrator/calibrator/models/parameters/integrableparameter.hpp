@@ -0,0 +1,53 @@
+#ifndef CALIBRATOR_MODELS_PARAMETERS_INTEGRABLEPARAMETER_HPP
+#define CALIBRATOR_MODELS_PARAMETERS_INTEGRABLEPARAMETER_HPP
+
+#include <ql/models/parameter.hpp>
+
+#include <calibrator/global.hpp>
+
+namespace HJCALIBRATOR
+{
+	//! Parameter with a closed form integral over time
+	/*! The implementation is kept when the parameter is copied into a plain Parameter,
+	so the integral stays available through integrate() on any copy.
+	*/
+	class IntegrableParameter : public Parameter
+	{
+	public:
+		class Impl : public Parameter::Impl
+		{
+		public:
+			virtual Real integral( const Array& params, Time t0, Time t1 ) const = 0;
+		};
+
+		Real integral( Time t0, Time t1 ) const
+		{
+			return static_cast<const IntegrableParameter::Impl&>( *impl_ ).integral( params_, t0, t1 );
+		}
+
+	protected:
+		IntegrableParameter( Size size,
+							 const shared_ptr<IntegrableParameter::Impl>& impl,
+							 const Constraint& constraint )
+			: Parameter( size, impl, constraint )
+		{}
+	};
+
+	//! Closed form \f$ \int_{t_0}^{t_1} p(u)du \f$ if the parameter is integrable
+	/*! Returns false, leaving the result untouched, when the implementation of the parameter
+	does not provide an integral, in which case a quadrature has to be used.
+	*/
+	inline bool integrate( const Parameter& parameter, Time t0, Time t1, Real& result )
+	{
+		const IntegrableParameter::Impl* impl
+			= dynamic_cast<const IntegrableParameter::Impl*>( parameter.implementation().get() );
+
+		if ( !impl )
+			return false;
+
+		result = impl->integral( parameter.params(), t0, t1 );
+		return true;
+	}
+}
+
+#endif // !CALIBRATOR_MODELS_PARAMETERS_INTEGRABLEPARAMETER_HPP
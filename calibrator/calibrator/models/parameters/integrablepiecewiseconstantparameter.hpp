@@ -0,0 +1,81 @@
+#ifndef CALIBRATOR_MODELS_PARAMETERS_INTEGRABLEPIECEWISECONSTANTPARAMETER_HPP
+#define CALIBRATOR_MODELS_PARAMETERS_INTEGRABLEPIECEWISECONSTANTPARAMETER_HPP
+
+#include <vector>
+
+#include <calibrator/models/parameters/integrableparameter.hpp>
+
+namespace HJCALIBRATOR
+{
+	//! Piecewise constant parameter with its integral
+	/*! Same convention as PiecewiseConstantParameter : the i-th parameter applies before
+	the i-th node, and the last one after the last node.
+	*/
+	class IntegrablePiecewiseConstantParameter : public IntegrableParameter
+	{
+		friend class ParameterSnapshot;
+
+	private:
+		class Impl : public IntegrableParameter::Impl
+		{
+		public:
+			Impl( const std::vector<Time>& times )
+				: times_( times )
+			{}
+
+			Real value( const Array& params, Time t ) const
+			{
+				for ( Size i = 0; i < times_.size(); i++ )
+				{
+					if ( t < times_[i] )
+						return params[i];
+				}
+
+				return params[times_.size()];
+			}
+
+			Real integral( const Array& params, Time t0, Time t1 ) const
+			{
+				return primitive( params, t1 ) - primitive( params, t0 );
+			}
+
+			const std::vector<Time>& times() const { return times_; }
+
+		private:
+			// integral from 0 to t
+			Real primitive( const Array& params, Time t ) const
+			{
+				Real sum = 0;
+				Time begin = 0;
+
+				for ( Size i = 0; i < times_.size(); i++ )
+				{
+					if ( t <= times_[i] )
+						return sum + params[i] * (t - begin);
+
+					sum += params[i] * (times_[i] - begin);
+					begin = times_[i];
+				}
+
+				return sum + params[times_.size()] * (t - begin);
+			}
+
+			std::vector<Time> times_;
+		};
+
+	public:
+		IntegrablePiecewiseConstantParameter( const std::vector<Time>& times,
+											  const Constraint& constraint = NoConstraint() )
+			: IntegrableParameter( times.size() + 1,
+								   shared_ptr<IntegrableParameter::Impl>( new IntegrablePiecewiseConstantParameter::Impl( times ) ),
+								   constraint )
+		{}
+
+		const std::vector<Time>& times() const
+		{
+			return static_cast<const IntegrablePiecewiseConstantParameter::Impl&>( *impl_ ).times();
+		}
+	};
+}
+
+#endif // !CALIBRATOR_MODELS_PARAMETERS_INTEGRABLEPIECEWISECONSTANTPARAMETER_HPP
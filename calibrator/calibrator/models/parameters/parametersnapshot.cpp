@@ -0,0 +1,39 @@
+#include <calibrator/models/parameters/parametersnapshot.hpp>
+#include <calibrator/models/parameters/integrableconstantparameter.hpp>
+#include <calibrator/models/parameters/integrablepiecewiseconstantparameter.hpp>
+#include <calibrator/models/parameters/piecewiselinearparameter.hpp>
+
+namespace HJCALIBRATOR
+{
+	ParameterSnapshot::ParameterSnapshot()
+		: kind_( Generic )
+	{}
+
+	ParameterSnapshot::ParameterSnapshot( const Parameter& parameter )
+		: kind_( Generic )
+		, values_( parameter.params().begin(), parameter.params().end() )
+	{
+		const Parameter::Impl* impl = parameter.implementation().get();
+
+		if ( dynamic_cast<const IntegrableConstantParameter::Impl*>( impl ) )
+		{
+			kind_ = Constant;
+		}
+		else if ( const IntegrablePiecewiseConstantParameter::Impl* pc
+				  = dynamic_cast<const IntegrablePiecewiseConstantParameter::Impl*>( impl ) )
+		{
+			kind_ = PiecewiseConstant;
+			times_ = pc->times();
+		}
+		else if ( const PiecewiseLinearParameter::Impl* pl
+				  = dynamic_cast<const PiecewiseLinearParameter::Impl*>( impl ) )
+		{
+			kind_ = PiecewiseLinear;
+			times_ = pl->times();
+		}
+		else
+		{
+			parameter_ = parameter;
+		}
+	}
+}
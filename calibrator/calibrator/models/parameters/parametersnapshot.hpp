@@ -0,0 +1,73 @@
+#ifndef CALIBRATOR_MODELS_PARAMETERS_PARAMETERSNAPSHOT_HPP
+#define CALIBRATOR_MODELS_PARAMETERS_PARAMETERSNAPSHOT_HPP
+
+#include <algorithm>
+#include <vector>
+
+#include <ql/models/parameter.hpp>
+
+#include <calibrator/global.hpp>
+
+namespace HJCALIBRATOR
+{
+	//! Flat copy of a parameter for evaluation in hot loops
+	/*! The constant, piecewise constant and piecewise linear parameters of this library are
+	copied into contiguous node and value arrays, and evaluated by a binary search without
+	any virtual call. Any other parameter is kept as is and evaluated through its implementation.
+
+	The snapshot does not follow later changes of the parameter it was taken from.
+	*/
+	class ParameterSnapshot
+	{
+	public:
+		enum Kind { Constant, PiecewiseConstant, PiecewiseLinear, Generic };
+
+		ParameterSnapshot();
+		explicit ParameterSnapshot( const Parameter& parameter );
+
+		Real operator()( Time t ) const;
+
+		Kind kind() const { return kind_; }
+		const std::vector<Time>& times() const { return times_; }
+		const std::vector<Real>& values() const { return values_; }
+
+	private:
+		Kind kind_;
+		std::vector<Time> times_;
+		std::vector<Real> values_;
+		Parameter parameter_;
+	};
+
+	// inline definitions
+
+	inline Real ParameterSnapshot::operator()( Time t ) const
+	{
+		switch ( kind_ )
+		{
+		case Constant:
+			return values_[0];
+
+		case PiecewiseConstant:
+			// the i-th value applies before the i-th node
+			return values_[std::upper_bound( times_.begin(), times_.end(), t ) - times_.begin()];
+
+		case PiecewiseLinear:
+		{
+			if ( t <= times_.front() )
+				return values_.front();
+			if ( t >= times_.back() )
+				return values_.back();
+
+			Size i = std::upper_bound( times_.begin(), times_.end(), t ) - times_.begin();
+			Real w = (t - times_[i - 1]) / (times_[i] - times_[i - 1]);
+
+			return (1 - w) * values_[i - 1] + w * values_[i];
+		}
+
+		default:
+			return parameter_( t );
+		}
+	}
+}
+
+#endif // !CALIBRATOR_MODELS_PARAMETERS_PARAMETERSNAPSHOT_HPP
@@ -0,0 +1,102 @@
+#ifndef CALIBRATOR_MODELS_PARAMETERS_PIECEWISELINEARPARAMETER_HPP
+#define CALIBRATOR_MODELS_PARAMETERS_PIECEWISELINEARPARAMETER_HPP
+
+#include <algorithm>
+
+#include <calibrator/models/parameters/integrableparameter.hpp>
+
+namespace HJCALIBRATOR
+{
+	//! Piecewise linear parameter
+	/*! The i-th parameter is the value at the i-th node, values are linearly interpolated
+	between the nodes and extrapolated flat before the first node and after the last one.
+	The integral is exact (trapezoids on each segment).
+	*/
+	class PiecewiseLinearParameter : public IntegrableParameter
+	{
+		friend class ParameterSnapshot;
+
+	private:
+		class Impl : public IntegrableParameter::Impl
+		{
+		public:
+			Impl( const std::vector<Time>& times )
+				: times_( times )
+			{}
+
+			Real value( const Array& params, Time t ) const
+			{
+				if ( t <= times_.front() )
+					return params[0];
+				if ( t >= times_.back() )
+					return params[times_.size() - 1];
+
+				Size i = std::upper_bound( times_.begin(), times_.end(), t ) - times_.begin();
+				Real w = (t - times_[i - 1]) / (times_[i] - times_[i - 1]);
+
+				return (1 - w) * params[i - 1] + w * params[i];
+			}
+
+			Real integral( const Array& params, Time t0, Time t1 ) const
+			{
+				return primitive( params, t1 ) - primitive( params, t0 );
+			}
+
+			const std::vector<Time>& times() const { return times_; }
+
+		private:
+			// integral from the first node to t
+			Real primitive( const Array& params, Time t ) const
+			{
+				if ( t <= times_.front() )
+					return params[0] * (t - times_.front());
+
+				Real sum = 0;
+				for ( Size i = 1; i < times_.size(); i++ )
+				{
+					if ( t <= times_[i] )
+						return sum + 0.5 * (params[i - 1] + value( params, t )) * (t - times_[i - 1]);
+
+					sum += 0.5 * (params[i - 1] + params[i]) * (times_[i] - times_[i - 1]);
+				}
+
+				return sum + params[times_.size() - 1] * (t - times_.back());
+			}
+
+			std::vector<Time> times_;
+		};
+
+	public:
+		PiecewiseLinearParameter( const std::vector<Time>& times,
+								  const Constraint& constraint = NoConstraint() )
+			: IntegrableParameter( times.size(),
+								   shared_ptr<IntegrableParameter::Impl>( new PiecewiseLinearParameter::Impl( times ) ),
+								   constraint )
+		{
+			QL_REQUIRE( !times.empty(), "At least one node is required for a piecewise linear parameter." );
+			QL_REQUIRE( std::is_sorted( times.begin(), times.end() ), "Nodes must be sorted." );
+		}
+
+		PiecewiseLinearParameter( const std::vector<Time>& times,
+								  const std::vector<Real>& values,
+								  const Constraint& constraint = NoConstraint() )
+			: PiecewiseLinearParameter( times, constraint )
+		{
+			QL_REQUIRE( times.size() == values.size(),
+						"The number of values is not equal to the number of nodes." );
+
+			for ( Size i = 0; i < values.size(); i++ )
+			{
+				params_[i] = values[i];
+			}
+			QL_REQUIRE( testParams( params_ ), "invalid value" );
+		}
+
+		const std::vector<Time>& times() const
+		{
+			return static_cast<const PiecewiseLinearParameter::Impl&>( *impl_ ).times();
+		}
+	};
+}
+
+#endif // !CALIBRATOR_MODELS_PARAMETERS_PIECEWISELINEARPARAMETER_HPP
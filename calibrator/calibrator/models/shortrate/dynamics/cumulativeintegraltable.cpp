@@ -0,0 +1,169 @@
+#include <calibrator/models/shortrate/dynamics/cumulativeintegraltable.hpp>
+#include <calibrator/models/shortrate/dynamics/gaussianfactordynamics.hpp>
+
+namespace HJCALIBRATOR
+{
+	CumulativeIntegralTable::CumulativeIntegralTable( const GaussianFactorDynamics& dynamics,
+													  Time horizon,
+													  Size steps )
+		: dimension_( dynamics.dimension() )
+		, horizon_( horizon ), dt_( horizon / steps ), steps_( steps )
+	{
+		QL_REQUIRE( horizon > 0, "The horizon of the cumulative integrals must be positive." );
+		QL_REQUIRE( steps > 0, "At least one step is required for the cumulative integrals." );
+
+		a_.resize( dimension_, RealVector( steps_ ) );
+		sigma_.resize( dimension_, RealVector( steps_ ) );
+		K_.resize( dimension_, RealVector( steps_ + 1, 0.0 ) );
+		h_.resize( dimension_, RealVector( steps_ + 1, 0.0 ) );
+
+		for ( Size i = 0; i < dimension_; i++ )
+		{
+			for ( Size k = 0; k < steps_; k++ )
+			{
+				Time mid = (k + 0.5) * dt_;
+				a_[i][k] = dynamics.a( i, mid );
+				sigma_[i][k] = dynamics.sigma( i, mid );
+
+				K_[i][k + 1] = K_[i][k] + a_[i][k] * dt_;
+			}
+
+			for ( Size k = steps_; k > 0; k-- )
+			{
+				h_[i][k - 1] = prependSegmentB( a_[i][k - 1], dt_, h_[i][k] );
+			}
+		}
+
+		Size npairs = dimension_ * (dimension_ + 1) / 2;
+		covariance_.resize( npairs, RealVector( steps_ ) );
+		v_.resize( npairs, RealVector( steps_ + 1, 0.0 ) );
+		Mij_.resize( npairs, RealVector( steps_ + 1, 0.0 ) );
+		Mji_.resize( npairs, RealVector( steps_ + 1, 0.0 ) );
+		J_.resize( npairs, RealVector( steps_ + 1, 0.0 ) );
+
+		for ( Size i = 0; i < dimension_; i++ )
+		{
+			for ( Size j = 0; j <= i; j++ )
+			{
+				Size p = pairIndex( i, j );
+				const ParameterSnapshot& rho = dynamics.rhoSnapshot( i, j );
+
+				SegmentPairIntegrals state;
+				for ( Size k = 0; k < steps_; k++ )
+				{
+					covariance_[p][k] = rho( (k + 0.5) * dt_ ) * sigma_[i][k] * sigma_[j][k];
+					state.advance( a_[i][k], a_[j][k], covariance_[p][k], dt_ );
+
+					v_[p][k + 1] = state.v;
+					Mij_[p][k + 1] = state.Mij;
+					Mji_[p][k + 1] = state.Mji;
+					J_[p][k + 1] = state.J;
+				}
+			}
+		}
+	}
+
+	Size CumulativeIntegralTable::cell( Time t ) const
+	{
+		QL_REQUIRE( t >= 0 && t <= horizon_ * (1 + 1e-12),
+					"Time " << t << " is out of the cumulative integral horizon [0, " << horizon_ << "]" );
+
+		Size k = static_cast<Size>( t / dt_ );
+		return std::min( k, steps_ - 1 );
+	}
+
+	CumulativeIntegralTable::FactorState CumulativeIntegralTable::factorState( Size i, Time t ) const
+	{
+		Size k = cell( t );
+		Real ai = a_[i][k];
+
+		Time forward = t - k * dt_;
+		Time backward = (k + 1) * dt_ - t;
+
+		FactorState state;
+		state.K = K_[i][k] + ai * forward;
+		state.h = prependSegmentB( ai, backward, h_[i][k + 1] );
+
+		return state;
+	}
+
+	CumulativeIntegralTable::PairState CumulativeIntegralTable::pairState( Size i, Size j, Time t ) const
+	{
+		if ( i < j )
+		{
+			PairState state = pairState( j, i, t );
+			std::swap( state.Ki, state.Kj );
+			state.swap();
+
+			return state;
+		}
+
+		Size k = cell( t );
+		Size p = pairIndex( i, j );
+		Time dt = t - k * dt_;
+
+		Real ai = a_[i][k];
+		Real aj = a_[j][k];
+
+		PairState state;
+		state.Ki = K_[i][k] + ai * dt;
+		state.Kj = K_[j][k] + aj * dt;
+		state.v = v_[p][k];
+		state.Mij = Mij_[p][k];
+		state.Mji = Mji_[p][k];
+		state.J = J_[p][k];
+		state.advance( ai, aj, covariance_[p][k], dt );
+
+		return state;
+	}
+
+	Real CumulativeIntegralTable::E( Size i, Time s, Time t ) const
+	{
+		return exp( factorState( i, t ).K - factorState( i, s ).K );
+	}
+
+	Real CumulativeIntegralTable::B( Size i, Time s, Time t ) const
+	{
+		FactorState fs = factorState( i, s );
+		FactorState ft = factorState( i, t );
+
+		return fs.h - exp( -(ft.K - fs.K) ) * ft.h;
+	}
+
+	Real CumulativeIntegralTable::variance( Size i, Size j, Time s, Time t ) const
+	{
+		PairState ps = pairState( i, j, s );
+		PairState pt = pairState( i, j, t );
+
+		return pt.v - exp( -(pt.Ki - ps.Ki) - (pt.Kj - ps.Kj) ) * ps.v;
+	}
+
+	Real CumulativeIntegralTable::meanTforward( Size i, Size j, Time T, Time s, Time t ) const
+	{
+		PairState ps = pairState( i, j, s );
+		PairState pt = pairState( i, j, t );
+
+		Real var = pt.v - exp( -(pt.Ki - ps.Ki) - (pt.Kj - ps.Kj) ) * ps.v;
+
+		return B( j, t, T ) * var + pt.Mij
+			- exp( -(pt.Ki - ps.Ki) ) * (ps.Mij + B( j, s, t ) * ps.v);
+	}
+
+	Real CumulativeIntegralTable::integralVariance( Size i, Size j, Time s, Time t ) const
+	{
+		PairState ps = pairState( i, j, s );
+		PairState pt = pairState( i, j, t );
+
+		Real Bi = B( i, s, t );
+		Real Bj = B( j, s, t );
+
+		return pt.J - ps.J - Bj * ps.Mji - Bi * ps.Mij - Bi * Bj * ps.v;
+	}
+
+	Real CumulativeIntegralTable::phi( Size i, Size j, Time t ) const
+	{
+		PairState pt = pairState( i, j, t );
+
+		return pt.Mij + pt.Mji;
+	}
+}
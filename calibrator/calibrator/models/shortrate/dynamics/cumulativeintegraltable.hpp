@@ -0,0 +1,93 @@
+#ifndef CALIBRATOR_MODELS_SHORTRATE_DYNAMICS_CUMULATIVEINTEGRALTABLE_HPP
+#define CALIBRATOR_MODELS_SHORTRATE_DYNAMICS_CUMULATIVEINTEGRALTABLE_HPP
+
+#include <vector>
+
+#include <ql/types.hpp>
+
+#include <calibrator/global.hpp>
+#include <calibrator/models/shortrate/dynamics/segmentintegrals.hpp>
+
+namespace HJCALIBRATOR
+{
+	class GaussianFactorDynamics;
+
+	//! Cumulative integrals of a gaussian factor dynamics on a dense uniform grid
+	/*! The mean reversions and the volatilities are sampled at the mid-point of each cell,
+	and the following cumulative quantities are tabulated once at every grid point :
+	\f[
+	K_i(t) = \int_0^t a_i(u)du, \quad h_i(t) = B_i(t, t_{max}),
+	\f]
+	and for each pair of factors,
+	\f[
+	v_{ij}(t) = \int_0^t \frac{\sigma_i(u)\sigma_j(u)}{E_i(u,t)E_j(u,t)}du, \quad
+	M_{ij}(t) = \int_0^t \sigma_i(u)\sigma_j(u)\frac{B_j(u,t)}{E_i(u,t)}du, \quad
+	J_{ij}(t) = \int_0^t \sigma_i(u)\sigma_j(u)B_i(u,t)B_j(u,t)du.
+	\f]
+	All the tabulated values are bounded (no \f$ e^{K} \f$ factor is kept), and a query
+	for an arbitrary (s,t) is answered by extending the two enclosing grid points to s and t
+	within their cells and combining the results, which costs O(1).
+
+	The instantaneous correlation is sampled with the volatilities, and is included in the
+	pairwise integrals as in GaussianFactorDynamics.
+	*/
+	class CumulativeIntegralTable
+	{
+	public:
+		CumulativeIntegralTable( const GaussianFactorDynamics& dynamics,
+								 Time horizon,
+								 Size steps );
+
+		Time horizon() const { return horizon_; }
+
+		Real E( Size i, Time s, Time t ) const;
+		Real B( Size i, Time s, Time t ) const;
+
+		Real meanTforward( Size i, Size j, Time T, Time s, Time t ) const;
+		Real integralVariance( Size i, Size j, Time s, Time t ) const;
+		Real variance( Size i, Size j, Time s, Time t ) const;
+		Real phi( Size i, Size j, Time t ) const;
+
+	private:
+		struct FactorState
+		{
+			Real K;
+			Real h;
+		};
+
+		struct PairState : public SegmentPairIntegrals
+		{
+			Real Ki, Kj;
+		};
+
+		Size cell( Time t ) const;
+		Size pairIndex( Size i, Size j ) const { return i * (i + 1) / 2 + j; }
+
+		FactorState factorState( Size i, Time t ) const;
+		PairState pairState( Size i, Size j, Time t ) const;
+
+		Size dimension_;
+		Time horizon_;
+		Time dt_;
+		Size steps_;
+
+		// cell-wise parameters
+		std::vector<std::vector<Real>> a_;
+		std::vector<std::vector<Real>> sigma_;
+
+		// grid point values
+		std::vector<std::vector<Real>> K_;
+		std::vector<std::vector<Real>> h_;
+
+		// cell-wise rho_ij * sigma_i * sigma_j for j <= i
+		std::vector<std::vector<Real>> covariance_;
+
+		// grid point values for j <= i
+		std::vector<std::vector<Real>> v_;
+		std::vector<std::vector<Real>> Mij_;
+		std::vector<std::vector<Real>> Mji_;
+		std::vector<std::vector<Real>> J_;
+	};
+}
+
+#endif // !CALIBRATOR_MODELS_SHORTRATE_DYNAMICS_CUMULATIVEINTEGRALTABLE_HPP
@@ -0,0 +1,352 @@
+#ifndef CALIBRATOR_MODELS_SHORTRATE_DYNAMICS_FIXEDFACTORDYNAMICS_HPP
+#define CALIBRATOR_MODELS_SHORTRATE_DYNAMICS_FIXEDFACTORDYNAMICS_HPP
+
+#include <algorithm>
+#include <array>
+#include <vector>
+
+#include <ql/types.hpp>
+#include <ql/errors.hpp>
+
+#include <calibrator/global.hpp>
+#include <calibrator/models/shortrate/dynamics/gaussianfactordynamics.hpp>
+#include <calibrator/models/shortrate/dynamics/piecewiseconstantintegrals.hpp>
+#include <calibrator/models/shortrate/dynamics/segmentintegrals.hpp>
+
+namespace HJCALIBRATOR
+{
+	//! Dynamics of N = 1, 2 or 3 factors with constant mean reversions and piecewise constant volatilities
+	/*! A front end with the factor count known at compile time, built from GPPConstantDynamics or
+	GPPPCMRPCV as PiecewiseConstantIntegrals is, and answering the calls of the statically dispatched
+	pricers of GeneralizedG1 and GeneralizedG2. The mean reversions and the moments are held in
+	std::array, so that the factor and pair loops have constant bounds and are unrolled.
+
+	Every node of the node set shared by the pairs stores rho_ij sigma_i sigma_j and the prefix sums of
+	all the pairs, as GPPPCMRPCV does pair by pair. A query takes one pair of binary searches and the
+	decays of the 1 + N + N(N+1)/2 distinct rates 0, a_i and a_i + a_j for all the pairs together.
+
+	It is a snapshot : the dynamics it was built from may change afterwards without affecting it.
+	*/
+	template <Size N>
+	class FixedFactorDynamics
+	{
+		static_assert( N >= 1 && N <= 3, "The fixed factor dynamics has one to three factors." );
+
+	public:
+		static const Size Pairs = N * (N + 1) / 2;
+
+		typedef std::array<Real, N> FactorArray;
+		typedef std::array<FactorArray, N> FactorMatrix;
+
+		//! Same as GaussianFactorDynamics::Moments on fixed size storage
+		struct Moments
+		{
+			FactorMatrix variance;
+			FactorMatrix integralVariance;
+			FactorMatrix meanTforward;
+			FactorArray mean;
+		};
+
+		explicit FixedFactorDynamics( const GaussianFactorDynamics& dynamics );
+
+		Size dimension() const { return N; }
+
+		Real B( Size i, Time t, Time T ) const { return segmentB( a_[i], T - t ); }
+		void B( Size i, Time t, const TimeVector& T, RealVector& result ) const;
+
+		Real variance( Size i, Size j, Time s, Time t ) const;
+		//! Variance of the sum of the factors
+		Real variance( Time s, Time t ) const;
+
+		Real A( Time t, Time T ) const;
+		void A( Time t, const TimeVector& T, RealVector& result ) const;
+
+		void moments( Time s, Time t, Time T, Moments& result ) const;
+
+	private:
+		static const Size Rates = 1 + N + Pairs;
+
+		//! \f$ \int_s^t \rho_{ij}\sigma_i\sigma_j(u) e^{-r(t-u)}du \f$ for the rates 0, a_i, a_j, a_i+a_j of every pair
+		typedef std::array<std::array<Real, 4>, Pairs> PairIntegrals;
+
+		struct Node
+		{
+			Time time;
+			std::array<Real, Pairs> covariance;					// on the segment after the node
+			std::array<std::array<Real, 4>, Pairs> sums;		// the integrals over (0,time)
+		};
+
+		//! Position of the pair (i,j), i <= j, as in GaussianFactorDynamics
+		static Size pairIndex( Size i, Size j )
+		{
+			return i <= j ? j * (j + 1) / 2 + i : i * (i + 1) / 2 + j;
+		}
+
+		void pairIntegrals( Time s, Time t, PairIntegrals& integrals ) const;
+
+		//! \f$ \ln( A(t,T)P(0,t)/P(0,T) ) \f$ from the pair integrals over (0,t)
+		Real logA( const PairIntegrals& integrals, Time t, Time T ) const;
+
+		Handle<YieldTermStructure> termStructure_;
+
+		FactorArray a_;
+		//! 0, the a_i, then the a_i + a_j in the order of the pairs
+		std::array<Real, Rates> rates_;
+		//! Positions in rates_ of the four rates of each pair
+		std::array<std::array<Size, 4>, Pairs> pairRates_;
+
+		std::vector<Time> times_;		// 0 followed by the positive nodes
+		std::vector<Node> nodes_;
+	};
+
+	// template definitions
+
+	template <Size N>
+	const Size FixedFactorDynamics<N>::Pairs;
+
+	template <Size N>
+	const Size FixedFactorDynamics<N>::Rates;
+
+	template <Size N>
+	FixedFactorDynamics<N>::FixedFactorDynamics( const GaussianFactorDynamics& dynamics )
+		: termStructure_( dynamics.termStructure() )
+	{
+		QL_REQUIRE( dynamics.dimension() == N,
+					"The dynamics has " << dynamics.dimension() << " factors instead of " << N << "." );
+
+		PiecewiseConstantIntegrals<Real> integrals( dynamics );
+
+		rates_[0] = 0;
+		for ( Size i = 0; i < N; i++ )
+		{
+			a_[i] = integrals.a()[i];
+			rates_[1 + i] = a_[i];
+		}
+
+		for ( Size j = 0; j < N; j++ )
+		{
+			for ( Size i = 0; i <= j; i++ )
+			{
+				Size p = pairIndex( i, j );
+				rates_[1 + N + p] = a_[i] + a_[j];
+				pairRates_[p] = { { 0, 1 + i, 1 + j, 1 + N + p } };
+			}
+		}
+
+		times_.assign( 1, 0.0 );
+		for ( Time node : integrals.nodes() )
+		{
+			if ( node > 0 )
+				times_.push_back( node );
+		}
+
+		// the piecewise constant parameters are right-continuous at their nodes
+		nodes_.resize( times_.size() );
+		for ( Size k = 0; k < nodes_.size(); k++ )
+		{
+			Node& node = nodes_[k];
+			node.time = times_[k];
+
+			Size segment = std::upper_bound( integrals.nodes().begin(), integrals.nodes().end(), node.time )
+				- integrals.nodes().begin();
+
+			for ( Size j = 0; j < N; j++ )
+			{
+				for ( Size i = 0; i <= j; i++ )
+				{
+					Size p = pairIndex( i, j );
+					node.covariance[p] = integrals.rho()[p][segment]
+						* integrals.sigma()[i][segment] * integrals.sigma()[j][segment];
+				}
+			}
+
+			for ( Size p = 0; p < Pairs; p++ )
+			{
+				for ( Size r = 0; r < 4; r++ )
+				{
+					if ( k == 0 )
+					{
+						node.sums[p][r] = 0;
+						continue;
+					}
+
+					const Node& previous = nodes_[k - 1];
+					Real rate = rates_[pairRates_[p][r]];
+					Time dt = node.time - previous.time;
+
+					node.sums[p][r] = exp( -rate * dt ) * previous.sums[p][r] + previous.covariance[p] * segmentB( rate, dt );
+				}
+			}
+		}
+	}
+
+	template <Size N>
+	void FixedFactorDynamics<N>::pairIntegrals( Time s, Time t, PairIntegrals& integrals ) const
+	{
+		// last node before s and t, shared by every pair
+		Size ks = std::upper_bound( times_.begin(), times_.end(), s ) - times_.begin();
+		Size kt = std::upper_bound( times_.begin(), times_.end(), t ) - times_.begin();
+		const Node& nodeS = nodes_[ks > 0 ? ks - 1 : 0];
+		const Node& nodeT = nodes_[kt > 0 ? kt - 1 : 0];
+
+		Time ds = s - nodeS.time;
+		Time dt = t - nodeT.time;
+
+		// the decays and the segment integrals of the distinct rates, once for all the pairs
+		std::array<Real, Rates> decayS, decayT, decayST, segmentS, segmentT;
+		for ( Size r = 0; r < Rates; r++ )
+		{
+			Real rate = rates_[r];
+
+			decayS[r] = exp( -rate * ds );
+			decayT[r] = exp( -rate * dt );
+			decayST[r] = exp( -rate * (t - s) );
+			segmentS[r] = segmentB( rate, ds );
+			segmentT[r] = segmentB( rate, dt );
+		}
+
+		for ( Size p = 0; p < Pairs; p++ )
+		{
+			for ( Size r = 0; r < 4; r++ )
+			{
+				Size q = pairRates_[p][r];
+
+				Real Ps = decayS[q] * nodeS.sums[p][r] + nodeS.covariance[p] * segmentS[q];
+				Real Pt = decayT[q] * nodeT.sums[p][r] + nodeT.covariance[p] * segmentT[q];
+
+				integrals[p][r] = Pt - decayST[q] * Ps;
+			}
+		}
+	}
+
+	template <Size N>
+	void FixedFactorDynamics<N>::B( Size i, Time t, const TimeVector& T, RealVector& result ) const
+	{
+		result.resize( T.size() );
+
+		for ( Size k = 0; k < T.size(); k++ )
+		{
+			result[k] = B( i, t, T[k] );
+		}
+	}
+
+	template <Size N>
+	Real FixedFactorDynamics<N>::variance( Size i, Size j, Time s, Time t ) const
+	{
+		PairIntegrals integrals;
+		pairIntegrals( s, t, integrals );
+
+		return integrals[pairIndex( i, j )][3];
+	}
+
+	template <Size N>
+	Real FixedFactorDynamics<N>::variance( Time s, Time t ) const
+	{
+		PairIntegrals integrals;
+		pairIntegrals( s, t, integrals );
+
+		Real sum = 0;
+		for ( Size j = 0; j < N; j++ )
+		{
+			for ( Size i = 0; i <= j; i++ )
+			{
+				sum += (i == j ? 1 : 2) * integrals[pairIndex( i, j )][3];
+			}
+		}
+
+		return sum;
+	}
+
+	template <Size N>
+	Real FixedFactorDynamics<N>::logA( const PairIntegrals& integrals, Time t, Time T ) const
+	{
+		FactorArray BtT;
+		for ( Size i = 0; i < N; i++ )
+		{
+			BtT[i] = B( i, t, T );
+		}
+
+		// V(0,T) - V(t,T) - V(0,t) from the pairwise moments at t, as in GaussianFactorDynamics::A
+		Real exponent = 0;
+		for ( Size j = 0; j < N; j++ )
+		{
+			for ( Size i = 0; i <= j; i++ )
+			{
+				const std::array<Real, 4>& pair = integrals[pairIndex( i, j )];
+				Real Mij = (pair[1] - pair[3]) / a_[j];
+				Real Mji = (pair[2] - pair[3]) / a_[i];
+				Real integ = BtT[i] * BtT[j] * pair[3] + BtT[i] * Mij + BtT[j] * Mji;
+
+				exponent += (i == j ? 1 : 2) * integ;
+			}
+		}
+
+		return -0.5 * exponent;
+	}
+
+	template <Size N>
+	Real FixedFactorDynamics<N>::A( Time t, Time T ) const
+	{
+		PairIntegrals integrals;
+		pairIntegrals( 0.0, t, integrals );
+
+		return termStructure_->discount( T ) / termStructure_->discount( t ) * exp( logA( integrals, t, T ) );
+	}
+
+	template <Size N>
+	void FixedFactorDynamics<N>::A( Time t, const TimeVector& T, RealVector& result ) const
+	{
+		// the moments at t are shared by every maturity
+		PairIntegrals integrals;
+		pairIntegrals( 0.0, t, integrals );
+
+		Real discount_t = termStructure_->discount( t );
+
+		result.resize( T.size() );
+		for ( Size k = 0; k < T.size(); k++ )
+		{
+			result[k] = termStructure_->discount( T[k] ) / discount_t * exp( logA( integrals, t, T[k] ) );
+		}
+	}
+
+	template <Size N>
+	void FixedFactorDynamics<N>::moments( Time s, Time t, Time T, Moments& result ) const
+	{
+		PairIntegrals integrals;
+		pairIntegrals( s, t, integrals );
+
+		FactorArray ET;
+		for ( Size i = 0; i < N; i++ )
+		{
+			ET[i] = exp( -a_[i] * (T - t) );
+		}
+
+		// as in GPPPCMRPCV::moments
+		for ( Size j = 0; j < N; j++ )
+		{
+			for ( Size i = 0; i <= j; i++ )
+			{
+				const std::array<Real, 4>& pair = integrals[pairIndex( i, j )];
+
+				result.variance[i][j] = result.variance[j][i] = pair[3];
+				result.integralVariance[i][j] = result.integralVariance[j][i]
+					= (pair[0] - pair[1] - pair[2] + pair[3]) / a_[i] / a_[j];
+				result.meanTforward[i][j] = (pair[1] - ET[j] * pair[3]) / a_[j];
+				result.meanTforward[j][i] = (pair[2] - ET[i] * pair[3]) / a_[i];
+			}
+		}
+
+		for ( Size i = 0; i < N; i++ )
+		{
+			Real sum = 0;
+			for ( Size j = 0; j < N; j++ )
+			{
+				sum += result.meanTforward[i][j];
+			}
+
+			result.mean[i] = -sum;
+		}
+	}
+}
+
+#endif // !CALIBRATOR_MODELS_SHORTRATE_DYNAMICS_FIXEDFACTORDYNAMICS_HPP
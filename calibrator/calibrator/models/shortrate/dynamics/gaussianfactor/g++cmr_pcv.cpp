@@ -1,4 +1,6 @@
+#include <calibrator/math/batchmath.hpp>
 #include <calibrator/models/shortrate/dynamics/gaussianfactor/g++cmr_pcv.hpp>
+#include <calibrator/models/shortrate/dynamics/segmentintegrals.hpp>
 
 namespace HJCALIBRATOR
 {
@@ -19,7 +21,7 @@ namespace HJCALIBRATOR
 						"Requirement not met for " << i << "-th sigma parameter "
 						<< ": node size + 1 == init value size" );
 
-			PiecewiseConstantParameter tmpparam( nodes, PositiveConstraint() );
+			IntegrablePiecewiseConstantParameter tmpparam( nodes, PositiveConstraint() );
 
 			for ( Size j = 0; j < initval.size(); j++ )
 			{
@@ -32,221 +34,319 @@ namespace HJCALIBRATOR
 		return rv;
 	}
 
-	Real GPPPCMRPCV::meanTforward( Size i, Size j, Time T, Time s, Time t ) const
+	Parameter convertCorrelationParameter( const RealVector& rho_node,
+										   const RealVector& initial_rho )
 	{
-		Real ai = a( i, 0.0 );
-		Real aj = a( j, 0.0 );
+		QL_REQUIRE( rho_node.size() + 1 == initial_rho.size(),
+					"Requirement not met for the correlation parameter : node size + 1 == init value size" );
 
-		const Parameter& sigma_i = sigma( i );
-		const Parameter& sigma_j = sigma( j );
+		IntegrablePiecewiseConstantParameter rv( rho_node, BoundaryConstraint( -1, 1 ) );
 
-		RealVector::const_iterator it_nodes = combined_nodes_[i][j].begin();
-		while ( it_nodes != combined_nodes_[i][j].end() && *it_nodes < s )
+		for ( Size k = 0; k < initial_rho.size(); k++ )
 		{
-			it_nodes++;
+			rv.setParam( k, initial_rho[k] );
 		}
 
-		Real intsum = 0;
+		return rv;
+	}
+
+	Real GPPPCMRPCV::meanTforward( Size i, Size j, Time T, Time s, Time t ) const
+	{
+		Real integrals[4];
+		segmentIntegrals( i, j, s, t, integrals );
+
+		Real aj = a( j, 0.0 );
 
-		Real begin = s;
+		return (integrals[1] - exp( -aj * (T - t) ) * integrals[3]) / aj;
+	}
 
-		while ( it_nodes != combined_nodes_[i][j].end() && *it_nodes < t )
-		{
-			Real end = *it_nodes;
-			Real mid = (end + begin) / 2.;
+	Real GPPPCMRPCV::integralVariance( Size i, Size j, Time s, Time t ) const
+	{
+		Real integrals[4];
+		segmentIntegrals( i, j, s, t, integrals );
 
-			Real et = t - end;
-			Real bt = t - begin;
+		return (integrals[0] - integrals[1] - integrals[2] + integrals[3]) / a( i, 0.0 ) / a( j, 0.0 );
+	}
 
-			Real integral = (exp( -ai * et ) - exp( -ai * bt )) / ai / aj
-				- (exp( (ai + aj)*end ) - exp( (ai + aj)*begin )) * exp( -ai * t - aj * T ) / (ai + aj) / aj;
+	Real GPPPCMRPCV::variance( Size i, Size j, Time s, Time t ) const
+	{
+		return segmentIntegral( segmentIndex( i, j ), 3, s, t );
+	}
 
-			Real sigmai = sigma_i( mid );
-			Real sigmaj = sigma_j( mid );
+	void GPPPCMRPCV::covariance( Time s, Time t, Matrix& result ) const
+	{
+		Size n = dimension();
+
+		if ( result.rows() != n || result.columns() != n )
+			result = Matrix( n, n );
 
-			intsum += sigmai*sigmaj*integral;
-			begin = end;
-			it_nodes++;
+		for ( Size i = 0; i < n; i++ )
+		{
+			for ( Size j = 0; j <= i; j++ )
+			{
+				result[i][j] = result[j][i] = segmentIntegral( segmentIndex( i, j ), 3, s, t );
+			}
 		}
+	}
+
+	void GPPPCMRPCV::variance( Size i, Size j, Time s, const TimeVector& t, RealVector& result ) const
+	{
+		Real asum = a( i, 0.0 ) + a( j, 0.0 );
+
+		result.resize( t.size() );
 
-		Real end = t;
-		Real mid = (t + begin) / 2.;
+		Time last = s;
+		Real val = 0;
 
-		Real sigmai = sigma_i( mid );
-		Real sigmaj = sigma_j( mid );
+		for ( Size k = 0; k < t.size(); k++ )
+		{
+			if ( t[k] < last )
+			{
+				last = s;
+				val = 0;
+			}
 
-		intsum += sigmai*sigmaj
-			*((1 - exp( -ai * (end - begin) )) / ai / aj
-			   - (exp( (ai + aj)*end ) - exp( (ai + aj)*begin )) * exp( -ai * t - aj * T ) / (ai + aj) / aj);
+			val = exp( -asum * (t[k] - last) ) * val + variance( i, j, last, t[k] );
 
-		return intsum;
+			last = t[k];
+			result[k] = val;
+		}
 	}
 
-	Real GPPPCMRPCV::integralVariance( Size i, Size j, Time s, Time t ) const
+	void GPPPCMRPCV::moments( Time s, Time t, Time T, Moments& result ) const
 	{
-		Real ai = a( i, 0.0 );
-		Real aj = a( j, 0.0 );
+		resizeMoments( result );
 
-		const Parameter& sigma_i = sigma( i );
-		const Parameter& sigma_j = sigma( j );
+		Size n = dimension();
 
-		RealVector::const_iterator it_nodes = combined_nodes_[i][j].begin();
-		while ( it_nodes != combined_nodes_[i][j].end() && *it_nodes < s )
+		RealVector ET( n );
+		for ( Size i = 0; i < n; i++ )
 		{
-			it_nodes++;
+			ET[i] = exp( -a( i, 0.0 ) * (T - t) );
 		}
 
-		Real intsum = 0;
-
-		Real begin = s;
-		
-		while ( it_nodes != combined_nodes_[i][j].end() && *it_nodes < t )
+		for ( Size i = 0; i < n; i++ )
 		{
-			Real end = *it_nodes;
-			Real mid = (end + begin) / 2.;
-			Real dt = end - begin;
+			for ( Size j = 0; j <= i; j++ )
+			{
+				// the rates of the pair (j,i) are those of (i,j) with a_i and a_j swapped
+				Real integrals[4];
+				segmentIntegrals( i, j, s, t, integrals );
+
+				Real ai = a( i, 0.0 );
+				Real aj = a( j, 0.0 );
+
+				result.variance[i][j] = result.variance[j][i] = integrals[3];
+				result.integralVariance[i][j] = result.integralVariance[j][i]
+					= (integrals[0] - integrals[1] - integrals[2] + integrals[3]) / ai / aj;
+				result.meanTforward[i][j] = (integrals[1] - ET[j] * integrals[3]) / aj;
+				result.meanTforward[j][i] = (integrals[2] - ET[i] * integrals[3]) / ai;
+			}
+		}
 
-			Real et = t - end;
-			Real bt = t - begin;
+		sumMeanTforward( result );
+	}
 
-			Real sigmai = sigma_i( mid );
-			Real sigmaj = sigma_j( mid );
+	Real GPPPCMRPCV::phi( Size i, Size j, Time t ) const
+	{
+		Real integrals[4];
+		segmentIntegrals( i, j, 0, t, integrals );
 
-			Real asum = ai + aj;
-			Real c = sigmai * sigmaj / ai / aj;
+		Real ai = a( i, 0.0 );
+		Real aj = a( j, 0.0 );
 
+		return (ai * integrals[1] + aj * integrals[2] - (ai + aj) * integrals[3]) / ai / aj;
+	}
 
-			intsum += c * (dt
-							+ (exp( -asum * et ) - exp( -asum * bt )) / asum
-							- (exp( -ai * et ) - exp( -ai * bt )) / ai
-							- (exp( -aj * et ) - exp( -aj * bt )) / aj);
-			begin = end;
-			it_nodes++;
-		}
+	void GPPPCMRPCV::combineNodes( const std::vector<RealVector>& sigma_nodes )
+	{
+		Size dim = dimension();
 
-		Real end = t;
-		Real mid = (t + begin) / 2.;
-		Real dt = end - begin;
+		combined_nodes_.resize( dim, std::vector<RealVector>( dim ) );
 
-		Real sigmai = sigma_i( mid );
-		Real sigmaj = sigma_j( mid );
-		Real c = sigmai * sigmaj / ai / aj;
+		for ( Size i = 0; i < dim; i++ )
+		{
+			const RealVector& nodes_i = sigma_nodes[i];
 
+			for (Size j = 0; j < dim; j++ )
+			{
+				const RealVector& nodes_j = sigma_nodes[j];
 
-		intsum += c * (dt
-						+ (1 - exp( -(ai + aj) * dt )) / (ai + aj)
-						- (1 - exp( -ai * dt )) / ai
-						- (1 - exp( -aj * dt )) / aj);
+				RealVector& nodeij = combined_nodes_[i][j];
+				nodeij.reserve( nodes_i.size() + nodes_j.size() );
+				nodeij.insert( nodeij.end(), nodes_i.begin(), nodes_i.end() );
+				nodeij.insert( nodeij.end(), nodes_j.begin(), nodes_j.end() );
 
-		return intsum;
+				std::sort( nodeij.begin(), nodeij.end() );
+				nodeij.erase( unique( nodeij.begin(), nodeij.end() ), nodeij.end() );
+			}
+		}
 	}
 
-	Real GPPPCMRPCV::variance( Size i, Size j, Time s, Time t ) const
+	void GPPPCMRPCV::sigma( const Parameter& sigma, Size i )
 	{
-		Real asum = a( i, 0.0 ) + a( j, 0.0 );
+		requirePiecewiseConstant( sigma );
+		GPPConstantMeanReversion::sigma( sigma, i );
 
-		const Parameter& sigma_i = sigma( i );
-		const Parameter& sigma_j = sigma( j );
-
-		RealVector::const_iterator it_nodes = combined_nodes_[i][j].begin();
-		while ( it_nodes != combined_nodes_[i][j].end() && *it_nodes < s )
+		for ( Size j = 0; j < dimension(); j++ )
 		{
-			it_nodes++;
+			mergeNodes( i, j );
 		}
+	}
+
+	void GPPPCMRPCV::rho( const Parameter& rho, Size i, Size j )
+	{
+		requirePiecewiseConstant( rho );
+		GPPConstantMeanReversion::rho( rho, i, j );
+
+		mergeNodes( i, j );
+	}
+
+	void GPPPCMRPCV::mergeNodes( Size i, Size j )
+	{
+		RealVector& nodes = combined_nodes_[i][j];
+		mergeTimes( { &sigmaSnapshot( i ), &sigmaSnapshot( j ), &rhoSnapshot( i, j ) }, nodes );
 
-		Real intsum = 0;
+		combined_nodes_[j][i] = nodes;
+		index_.clear();
+	}
 
-		Real begin = s;
-		while ( it_nodes != combined_nodes_[i][j].end() && *it_nodes < t )
+	void GPPPCMRPCV::precompute() const
+	{
+		GPPConstantMeanReversion::precompute();
+		segmentIndex( 0, 0 );
+	}
+
+	const GPPPCMRPCV::SegmentIndex& GPPPCMRPCV::segmentIndex( Size i, Size j ) const
+	{
+		if ( index_.empty() || indexVersion_ != version() )
 		{
-			Real end = *it_nodes;
-			Real mid = (end + begin) / 2.;
+			Size dim = combined_nodes_.size();
+			index_.assign( dim, std::vector<SegmentIndex>( dim ) );
 
-			Real et = t - end;
-			Real bt = t - begin;
+			for ( Size k = 0; k < dim; k++ )
+			{
+				for ( Size l = 0; l < dim; l++ )
+				{
+					buildSegmentIndex( k, l, index_[k][l] );
+				}
+			}
 
-			intsum += sigma_i( mid )*sigma_j( mid )*(exp( -asum * et ) - exp( -asum * bt )) / asum;
-			begin = end;
-			it_nodes++;
+			indexVersion_ = version();
 		}
-		
-		Real end = t;
-		Real mid = (t + begin) / 2.;
-
-		intsum += sigma_i( mid )*sigma_j( mid )*(1 - exp( -asum * (end - begin) )) / asum;
 
-		return intsum;
+		return index_[i][j];
 	}
 
-	Real GPPPCMRPCV::phi( Size i, Size j, Time t ) const
+	void GPPPCMRPCV::buildSegmentIndex( Size i, Size j, SegmentIndex& index ) const
 	{
-		Real a_i = a( i )(0.0);
-		Real a_j = a( j )(0.0);
-
-		const Parameter& sigma_i = sigma( i );
-		const Parameter& sigma_j = sigma( j );
+		const ParameterSnapshot& sigma_i = sigmaSnapshot( i );
+		const ParameterSnapshot& sigma_j = sigmaSnapshot( j );
+		const ParameterSnapshot& rho_ij = rhoSnapshot( i, j );
 
-		Time s = 0;
+		index.rates[0] = 0;
+		index.rates[1] = a( i, 0.0 );
+		index.rates[2] = a( j, 0.0 );
+		index.rates[3] = index.rates[1] + index.rates[2];
 
-		RealVector::const_iterator it_nodes = combined_nodes_[i][j].begin();
-		while ( it_nodes != combined_nodes_[i][j].end() && *it_nodes < s )
+		index.nodes.assign( 1, 0.0 );
+		for ( Time node : combined_nodes_[i][j] )
 		{
-			it_nodes++;
+			if ( node > 0 )
+				index.nodes.push_back( node );
 		}
 
-		Real intsum = 0;
-
-		Real begin = s;
-		while ( it_nodes != combined_nodes_[i][j].end() && *it_nodes < t )
+		// the piecewise constant parameters are right-continuous at their nodes
+		Size n = index.nodes.size();
+		index.covariance.resize( n );
+		for ( Size k = 0; k < n; k++ )
 		{
-			Real end = *it_nodes;
-			Real mid = (end + begin) / 2.;
-
-			Real et = t - end;
-			Real bt = t - begin;
-
-			intsum += sigma_i( mid ) * sigma_j( mid )
-				* ((exp( -a_i * et ) - exp( -a_i * bt )) / a_i / a_i
-					- (exp( -(a_i + a_j) * et ) - exp( -(a_i + a_j) * bt )) / a_i / a_j
-					+ (exp( -a_j * et ) - exp( -a_j * bt )) / a_j / a_j);
-			
-			begin = end;
-			it_nodes++;
+			Time u = index.nodes[k];
+			index.covariance[k] = rho_ij( u ) * sigma_i( u ) * sigma_j( u );
 		}
 
-		Real end = t;
-		Real mid = (t + begin) / 2.;
-		Real bt = t - begin;
+		// the decays of all the segments are taken as one strip per rate
+		RealVector decay( n );
+		for ( Size r = 0; r < 4; r++ )
+		{
+			Real rate = index.rates[r];
+			RealVector& sums = index.sums[r];
+
+			for ( Size k = 1; k < n; k++ )
+			{
+				decay[k] = -rate * (index.nodes[k] - index.nodes[k - 1]);
+			}
 
-		intsum += sigma_i( mid ) * sigma_j( mid ) * ((1 - exp( -a_i * bt )) / a_i / a_i
-													  - (1 - exp( -(a_i + a_j) * bt )) / a_i / a_j
-													  + (1 - exp( -a_j * bt )) / a_j / a_j);
+			batchExp( decay.data() + 1, decay.data() + 1, n - 1 );
 
-		return intsum;
+			sums.assign( n, 0.0 );
+			for ( Size k = 1; k < n; k++ )
+			{
+				Time dt = index.nodes[k] - index.nodes[k - 1];
+				sums[k] = decay[k] * sums[k - 1] + index.covariance[k - 1] * segmentB( rate, dt );
+			}
+		}
 	}
 
-	void GPPPCMRPCV::combineNodes( const std::vector<RealVector>& sigma_nodes )
+	void GPPPCMRPCV::segmentIntegrals( Size i, Size j, Time s, Time t, Real integrals[4] ) const
 	{
-		Size dim = dimension();
+		const SegmentIndex& index = segmentIndex( i, j );
 
-		combined_nodes_.resize( dim, std::vector<RealVector>( dim ) );
+		// last node before s and t
+		Size ks = std::upper_bound( index.nodes.begin(), index.nodes.end(), s ) - index.nodes.begin();
+		Size kt = std::upper_bound( index.nodes.begin(), index.nodes.end(), t ) - index.nodes.begin();
+		ks = ks > 0 ? ks - 1 : 0;
+		kt = kt > 0 ? kt - 1 : 0;
 
-		for ( Size i = 0; i < dim; i++ )
+		Time ds = s - index.nodes[ks];
+		Time dt = t - index.nodes[kt];
+
+		// the three decays of the four rates, as one strip in a vectorised build
+		Real decay[12];
+		for ( Size r = 0; r < 4; r++ )
 		{
-			const RealVector nodes_i = sigma_nodes[i];
+			Real rate = index.rates[r];
+
+		#if defined( CALIBRATOR_VECTORISED_MATH )
+			decay[3 * r] = -rate * ds;
+			decay[3 * r + 1] = -rate * dt;
+			decay[3 * r + 2] = -rate * (t - s);
+		#else
+			decay[3 * r] = exp( -rate * ds );
+			decay[3 * r + 1] = exp( -rate * dt );
+			decay[3 * r + 2] = exp( -rate * (t - s) );
+		#endif
+		}
 
-			for (Size j = 0; j < dim; j++ )
-			{
-				const RealVector nodes_j = sigma_nodes[j];
+	#if defined( CALIBRATOR_VECTORISED_MATH )
+		batchExp( decay, decay, 12 );
+	#endif
 
-				RealVector& nodeij = combined_nodes_[i][j];
-				nodeij.reserve( nodes_i.size() + nodes_j.size() );
-				nodeij.insert( nodeij.end(), nodes_i.begin(), nodes_i.end() );
-				nodeij.insert( nodeij.end(), nodes_i.begin(), nodes_i.end() );
+		for ( Size r = 0; r < 4; r++ )
+		{
+			Real rate = index.rates[r];
 
-				std::sort( nodeij.begin(), nodeij.end() );
-				nodeij.erase( unique( nodeij.begin(), nodeij.end() ), nodeij.end() );
-			}
+			Real Ps = decay[3 * r] * index.sums[r][ks] + index.covariance[ks] * segmentB( rate, ds );
+			Real Pt = decay[3 * r + 1] * index.sums[r][kt] + index.covariance[kt] * segmentB( rate, dt );
+
+			integrals[r] = Pt - decay[3 * r + 2] * Ps;
 		}
 	}
+
+	Real GPPPCMRPCV::segmentIntegral( const SegmentIndex& index, Size rate, Time s, Time t ) const
+	{
+		Size ks = std::upper_bound( index.nodes.begin(), index.nodes.end(), s ) - index.nodes.begin();
+		Size kt = std::upper_bound( index.nodes.begin(), index.nodes.end(), t ) - index.nodes.begin();
+		ks = ks > 0 ? ks - 1 : 0;
+		kt = kt > 0 ? kt - 1 : 0;
+
+		Real r = index.rates[rate];
+		Time ds = s - index.nodes[ks];
+		Time dt = t - index.nodes[kt];
+
+		Real Ps = exp( -r * ds ) * index.sums[rate][ks] + index.covariance[ks] * segmentB( r, ds );
+		Real Pt = exp( -r * dt ) * index.sums[rate][kt] + index.covariance[kt] * segmentB( r, dt );
+
+		return Pt - exp( -r * (t - s) ) * Ps;
+	}
 }
\ No newline at end of file
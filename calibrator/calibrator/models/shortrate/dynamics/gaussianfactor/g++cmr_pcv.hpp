@@ -1,6 +1,7 @@
 #ifndef CALIBRATOR_MODELS_SHORTRATE_DYNAMICS_GAUSSIANFACTOR_GPPCMR_PCV_HPP
 #define CALIBRATOR_MODELS_SHORTRATE_DYNAMICS_GAUSSIANFACTOR_GPPCMR_PCV_HPP
 
+#include <calibrator/models/parameters/integrablepiecewiseconstantparameter.hpp>
 #include <calibrator/models/shortrate/dynamics/gaussianfactor/g++constantmeanreversion.hpp>
 
 namespace HJCALIBRATOR
@@ -8,10 +9,35 @@ namespace HJCALIBRATOR
 	ParamVector convertParamVector( const std::vector<RealVector>& sigma_node,
 									const std::vector<RealVector>& initial_sigma );
 
+	//! Piecewise constant correlation bounded in [-1, 1]
+	Parameter convertCorrelationParameter( const RealVector& rho_node,
+										   const RealVector& initial_rho );
+
+	//! Constant mean reversions with piecewise constant volatilities
+	/*! The pairwise integrals are answered from prefix sums over the combined nodes of each pair,
+	\f[
+	P_r(n_k) = \int_0^{n_k} \rho_{ij}\sigma_i\sigma_j(u) e^{-r(n_k-u)}du, \quad r \in \{0, a_i, a_j, a_i+a_j\},
+	\f]
+	which stay bounded and are shifted to any end time x by \f$ P_r(x) = e^{-r(x-n_k)}P_r(n_k) + \f$ the
+	partial segment. Any integral over (s,t) is then \f$ P_r(t) - e^{-r(t-s)}P_r(s) \f$, which costs two
+	binary searches whatever the number of nodes. The sums are rebuilt lazily after a parameter update.
+	*/
 	class GPPPCMRPCV : public GPPConstantMeanReversion
 	{
 		std::vector<std::vector<RealVector>> combined_nodes_;
 
+		//! Prefix sums of a pair, for the rates 0, a_i, a_j and a_i+a_j
+		struct SegmentIndex
+		{
+			RealVector nodes;		// 0 followed by the positive combined nodes
+			RealVector covariance;	// rho_ij sigma_i sigma_j on the segment after each node
+			Real rates[4];
+			RealVector sums[4];
+		};
+
+		mutable Size indexVersion_;
+		mutable std::vector<std::vector<SegmentIndex>> index_;
+
 	public:
 		GPPPCMRPCV( const Handle<YieldTermStructure>& termStructure,
 					const RealVector& a,
@@ -21,26 +47,60 @@ namespace HJCALIBRATOR
 			: GPPConstantMeanReversion( termStructure, 
 										a, 
 										convertParamVector( sigma_nodes, initial_sigma ), rho )
+			, indexVersion_( 0 )
 		{
 			combineNodes( sigma_nodes );
 		}
 
 		virtual ~GPPPCMRPCV() {}
 
+		using GPPConstantMeanReversion::variance;
+		using GPPConstantMeanReversion::sigma;
+		using GPPConstantMeanReversion::rho;
+
+		//! The segments of the pairs of the factor are merged again with the nodes of the new volatility
+		virtual void sigma( const Parameter& sigma, Size i ) override;
+		//! Same as above for a piecewise constant correlation
+		virtual void rho( const Parameter& rho, Size i, Size j ) override;
+
 		virtual Real meanTforward( Size i, Size j, Time T, Time s, Time t ) const override;
 		virtual Real integralVariance( Size i, Size j, Time s, Time t ) const override;
 		virtual Real variance( Size i, Size j, Time s, Time t ) const override;
 
+		//! Increasing end times are accumulated from the previous one, so each segment is visited once
+		virtual void variance( Size i, Size j, Time s, const TimeVector& t, RealVector& result ) const override;
+
+		//! One walk of the prefix sums per pair
+		virtual void moments( Time s, Time t, Time T, Moments& result ) const override;
+		virtual void covariance( Time s, Time t, Matrix& result ) const override;
+
 	protected:
+		virtual GaussianFactorDynamics* clone() const override { return new GPPPCMRPCV( *this ); }
+
 		GPPPCMRPCV( const std::vector<RealVector>& sigma_nodes )
+			: indexVersion_( 0 )
 		{
 			combineNodes( sigma_nodes );
 		}
 
 		virtual Real phi( Size i, Size j, Time t ) const override;
 
+		//! Builds the prefix sums of every pair
+		virtual void precompute() const override;
+
 	private:
 		void combineNodes( const std::vector<RealVector>& sigma_nodes );
+		//! Nodes of the pair (i,j) from the snapshots of its volatilities and correlation
+		void mergeNodes( Size i, Size j );
+
+		//! Up-to-date prefix sums of the pair (i,j)
+		const SegmentIndex& segmentIndex( Size i, Size j ) const;
+		void buildSegmentIndex( Size i, Size j, SegmentIndex& index ) const;
+
+		//! \f$ \int_s^t \rho_{ij}\sigma_i\sigma_j(u) e^{-r(t-u)}du \f$ for the four rates of the pair
+		void segmentIntegrals( Size i, Size j, Time s, Time t, Real integrals[4] ) const;
+		//! Same as above for the rate of the given position only
+		Real segmentIntegral( const SegmentIndex& index, Size rate, Time s, Time t ) const;
 	};
 
 	class G1PPPCMRPCV : public Gaussian1FactorDynamics, public GPPPCMRPCV
@@ -51,13 +111,16 @@ namespace HJCALIBRATOR
 					 const RealVector& sigma_node,
 					 const RealVector& initial_sigma )
 			: GaussianFactorDynamics( termStructure,
-									  { ConstantParameter( a, PositiveConstraint() ) },
+									  { IntegrableConstantParameter( a, PositiveConstraint() ) },
 									  convertParamVector( { sigma_node }, { initial_sigma } ),
 									  Matrix( 1, 1, 1))
 			, GPPPCMRPCV( { sigma_node } )
 		{}
 
 		virtual ~G1PPPCMRPCV() {}
+
+	protected:
+		virtual GaussianFactorDynamics* clone() const override { return new G1PPPCMRPCV( *this ); }
 	};
 
 	class G2PPPCMRPCV : public Gaussian2FactorDynamics, public GPPPCMRPCV
@@ -72,13 +135,35 @@ namespace HJCALIBRATOR
 					 const RealVector& initial_eta,
 					 Real rho )
 			: GaussianFactorDynamics( termStructure,
-									   { ConstantParameter( a, PositiveConstraint() ), ConstantParameter( b, PositiveConstraint() ) },
+									   { IntegrableConstantParameter( a, PositiveConstraint() ), IntegrableConstantParameter( b, PositiveConstraint() ) },
 									   convertParamVector( { sigma_node, eta_node }, { initial_sigma, initial_eta } ),
 									   getCorrelationMatrix( rho ) )
 			, GPPPCMRPCV( { sigma_node, eta_node } )
 		{}
 
+		//! Same as above with a piecewise constant correlation between the two factors
+		G2PPPCMRPCV( const Handle<YieldTermStructure>& termStructure,
+					 Real a,
+					 const RealVector& sigma_node,
+					 const RealVector& initial_sigma,
+					 Real b,
+					 const RealVector& eta_node,
+					 const RealVector& initial_eta,
+					 const RealVector& rho_node,
+					 const RealVector& initial_rho )
+			: GaussianFactorDynamics( termStructure,
+									   { IntegrableConstantParameter( a, PositiveConstraint() ), IntegrableConstantParameter( b, PositiveConstraint() ) },
+									   convertParamVector( { sigma_node, eta_node }, { initial_sigma, initial_eta } ),
+									   getCorrelationMatrix( 0.0 ) )
+			, GPPPCMRPCV( { sigma_node, eta_node } )
+		{
+			rho( convertCorrelationParameter( rho_node, initial_rho ), 0, 1 );
+		}
+
 		virtual ~G2PPPCMRPCV() {}
+
+	protected:
+		virtual GaussianFactorDynamics* clone() const override { return new G2PPPCMRPCV( *this ); }
 	};
 }
 
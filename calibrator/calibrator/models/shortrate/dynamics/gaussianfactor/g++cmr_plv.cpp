@@ -0,0 +1,186 @@
+#include <calibrator/models/shortrate/dynamics/gaussianfactor/g++cmr_plv.hpp>
+
+namespace HJCALIBRATOR
+{
+	ParamVector convertLinearParamVector( const std::vector<RealVector>& sigma_node,
+										  const std::vector<RealVector>& initial_sigma )
+	{
+		QL_REQUIRE( sigma_node.size() == initial_sigma.size(),
+					"Sigma parameter dimesion mismatched." );
+
+		ParamVector rv;
+
+		for ( Size i = 0; i < sigma_node.size(); i++ )
+		{
+			const RealVector& nodes = sigma_node[i];
+			const RealVector& initval = initial_sigma[i];
+
+			if ( nodes.empty() )
+			{
+				QL_REQUIRE( initval.size() == 1,
+							"Requirement not met for " << i << "-th sigma parameter "
+							<< ": a single value is required without nodes" );
+
+				rv.push_back( ConstantParameter( initval[0], PositiveConstraint() ) );
+				continue;
+			}
+
+			QL_REQUIRE( nodes.size() == initval.size(),
+						"Requirement not met for " << i << "-th sigma parameter "
+						<< ": node size == init value size" );
+
+			rv.push_back( PiecewiseLinearParameter( nodes, initval, PositiveConstraint() ) );
+		}
+
+		return rv;
+	}
+
+	SegmentPairIntegrals GPPPCMRPLV::pairIntegrals( Size i, Size j, Time s, Time t ) const
+	{
+		Real ai = a( i, 0.0 );
+		Real aj = a( j, 0.0 );
+
+		const ParameterSnapshot& sigma_i = sigmaSnapshot( i );
+		const ParameterSnapshot& sigma_j = sigmaSnapshot( j );
+		const ParameterSnapshot& rho_ij = rhoSnapshot( i, j );
+
+		const RealVector& nodes = combined_nodes_[i][j];
+
+		RealVector::const_iterator it_nodes = std::upper_bound( nodes.begin(), nodes.end(), s );
+		RealVector::const_iterator it_last = std::lower_bound( nodes.begin(), nodes.end(), t );
+
+		SegmentPairIntegrals integrals;
+
+		Real begin = s;
+		Real sigmai_begin = sigma_i( begin );
+		Real sigmaj_begin = sigma_j( begin );
+
+		while ( begin < t )
+		{
+			Real end = it_nodes < it_last ? *it_nodes++ : t;
+			Real dt = end - begin;
+
+			Real sigmai_end = sigma_i( end );
+			Real sigmaj_end = sigma_j( end );
+
+			// sigma(u) = sigma(end) - g * (end - u) on the segment
+			Real gi = (sigmai_end - sigmai_begin) / dt;
+			Real gj = (sigmaj_end - sigmaj_begin) / dt;
+			Real rhoij = rho_ij( (begin + end) / 2. );
+
+			integrals.advance( ai, aj,
+							   rhoij * sigmai_end * sigmaj_end,
+							   -rhoij * (sigmai_end * gj + sigmaj_end * gi),
+							   rhoij * gi * gj,
+							   dt );
+
+			begin = end;
+			sigmai_begin = sigmai_end;
+			sigmaj_begin = sigmaj_end;
+		}
+
+		return integrals;
+	}
+
+	Real GPPPCMRPLV::meanTforward( Size i, Size j, Time T, Time s, Time t ) const
+	{
+		SegmentPairIntegrals integrals = pairIntegrals( i, j, s, t );
+
+		return B( j, t, T ) * integrals.v + integrals.Mij;
+	}
+
+	Real GPPPCMRPLV::integralVariance( Size i, Size j, Time s, Time t ) const
+	{
+		return pairIntegrals( i, j, s, t ).J;
+	}
+
+	Real GPPPCMRPLV::variance( Size i, Size j, Time s, Time t ) const
+	{
+		return pairIntegrals( i, j, s, t ).v;
+	}
+
+	void GPPPCMRPLV::moments( Time s, Time t, Time T, Moments& result ) const
+	{
+		resizeMoments( result );
+
+		Size n = dimension();
+
+		RealVector BT( n );
+		for ( Size i = 0; i < n; i++ )
+		{
+			BT[i] = B( i, t, T );
+		}
+
+		for ( Size i = 0; i < n; i++ )
+		{
+			for ( Size j = 0; j <= i; j++ )
+			{
+				SegmentPairIntegrals integrals = pairIntegrals( i, j, s, t );
+
+				result.variance[i][j] = result.variance[j][i] = integrals.v;
+				result.integralVariance[i][j] = result.integralVariance[j][i] = integrals.J;
+				result.meanTforward[i][j] = BT[j] * integrals.v + integrals.Mij;
+				result.meanTforward[j][i] = BT[i] * integrals.v + integrals.Mji;
+			}
+		}
+
+		sumMeanTforward( result );
+	}
+
+	Real GPPPCMRPLV::phi( Size i, Size j, Time t ) const
+	{
+		SegmentPairIntegrals integrals = pairIntegrals( i, j, 0, t );
+
+		return integrals.Mij + integrals.Mji;
+	}
+
+	void GPPPCMRPLV::sigma( const Parameter& sigma, Size i )
+	{
+		ParameterSnapshot::Kind kind = ParameterSnapshot( sigma ).kind();
+		QL_REQUIRE( kind == ParameterSnapshot::Constant || kind == ParameterSnapshot::PiecewiseLinear,
+					"The volatility must be constant or piecewise linear." );
+		GPPConstantMeanReversion::sigma( sigma, i );
+
+		for ( Size j = 0; j < dimension(); j++ )
+		{
+			mergeNodes( i, j );
+		}
+	}
+
+	void GPPPCMRPLV::rho( const Parameter& rho, Size i, Size j )
+	{
+		requirePiecewiseConstant( rho );
+		GPPConstantMeanReversion::rho( rho, i, j );
+
+		mergeNodes( i, j );
+	}
+
+	void GPPPCMRPLV::mergeNodes( Size i, Size j )
+	{
+		RealVector& nodes = combined_nodes_[i][j];
+		mergeTimes( { &sigmaSnapshot( i ), &sigmaSnapshot( j ), &rhoSnapshot( i, j ) }, nodes );
+
+		combined_nodes_[j][i] = nodes;
+	}
+
+	void GPPPCMRPLV::combineNodes( const std::vector<RealVector>& sigma_nodes )
+	{
+		Size dim = sigma_nodes.size();
+
+		combined_nodes_.resize( dim, std::vector<RealVector>( dim ) );
+
+		for ( Size i = 0; i < dim; i++ )
+		{
+			for ( Size j = 0; j < dim; j++ )
+			{
+				RealVector& nodeij = combined_nodes_[i][j];
+				nodeij.reserve( sigma_nodes[i].size() + sigma_nodes[j].size() );
+				nodeij.insert( nodeij.end(), sigma_nodes[i].begin(), sigma_nodes[i].end() );
+				nodeij.insert( nodeij.end(), sigma_nodes[j].begin(), sigma_nodes[j].end() );
+
+				std::sort( nodeij.begin(), nodeij.end() );
+				nodeij.erase( unique( nodeij.begin(), nodeij.end() ), nodeij.end() );
+			}
+		}
+	}
+}
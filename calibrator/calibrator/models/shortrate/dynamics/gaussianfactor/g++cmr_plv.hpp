@@ -0,0 +1,116 @@
+#ifndef CALIBRATOR_MODELS_SHORTRATE_DYNAMICS_GAUSSIANFACTOR_GPPCMR_PLV_HPP
+#define CALIBRATOR_MODELS_SHORTRATE_DYNAMICS_GAUSSIANFACTOR_GPPCMR_PLV_HPP
+
+#include <calibrator/models/parameters/piecewiselinearparameter.hpp>
+#include <calibrator/models/shortrate/dynamics/segmentintegrals.hpp>
+#include <calibrator/models/shortrate/dynamics/gaussianfactor/g++constantmeanreversion.hpp>
+
+namespace HJCALIBRATOR
+{
+	ParamVector convertLinearParamVector( const std::vector<RealVector>& sigma_node,
+										  const std::vector<RealVector>& initial_sigma );
+
+	//! Gaussian factor dynamics with constant mean reversions and piecewise-linear volatilities
+	/*! The volatilities are linear between their nodes (flat outside). On every segment of the
+	merged node set, the integrands are of the form \f$ (\alpha+\beta u)(\gamma+\delta u)e^{\kappa u} \f$,
+	which are integrated in closed form.
+	*/
+	class GPPPCMRPLV : public GPPConstantMeanReversion
+	{
+		std::vector<std::vector<RealVector>> combined_nodes_;
+
+	public:
+		GPPPCMRPLV( const Handle<YieldTermStructure>& termStructure,
+					const RealVector& a,
+					const std::vector<RealVector>& sigma_nodes,
+					const std::vector<RealVector>& initial_sigma,
+					const Matrix& rho )
+			: GPPConstantMeanReversion( termStructure,
+										a,
+										convertLinearParamVector( sigma_nodes, initial_sigma ), rho )
+		{
+			combineNodes( sigma_nodes );
+		}
+
+		virtual ~GPPPCMRPLV() {}
+
+		using GPPConstantMeanReversion::variance;
+		using GPPConstantMeanReversion::sigma;
+		using GPPConstantMeanReversion::rho;
+
+		//! The segments of the pairs of the factor are merged again with the nodes of the new volatility
+		virtual void sigma( const Parameter& sigma, Size i ) override;
+		//! Same as above for a piecewise constant correlation
+		virtual void rho( const Parameter& rho, Size i, Size j ) override;
+
+		virtual Real meanTforward( Size i, Size j, Time T, Time s, Time t ) const override;
+		virtual Real integralVariance( Size i, Size j, Time s, Time t ) const override;
+		virtual Real variance( Size i, Size j, Time s, Time t ) const override;
+
+		//! One segment walk per pair
+		virtual void moments( Time s, Time t, Time T, Moments& result ) const override;
+
+	protected:
+		virtual GaussianFactorDynamics* clone() const override { return new GPPPCMRPLV( *this ); }
+
+		GPPPCMRPLV( const std::vector<RealVector>& sigma_nodes )
+		{
+			combineNodes( sigma_nodes );
+		}
+
+		virtual Real phi( Size i, Size j, Time t ) const override;
+
+	private:
+		void combineNodes( const std::vector<RealVector>& sigma_nodes );
+		//! Nodes of the pair (i,j) from the snapshots of its volatilities and correlation
+		void mergeNodes( Size i, Size j );
+
+		SegmentPairIntegrals pairIntegrals( Size i, Size j, Time s, Time t ) const;
+	};
+
+	class G1PPPCMRPLV : public Gaussian1FactorDynamics, public GPPPCMRPLV
+	{
+	public:
+		G1PPPCMRPLV( const Handle<YieldTermStructure>& termStructure,
+					 Real a,
+					 const RealVector& sigma_node,
+					 const RealVector& initial_sigma )
+			: GaussianFactorDynamics( termStructure,
+									  { IntegrableConstantParameter( a, PositiveConstraint() ) },
+									  convertLinearParamVector( { sigma_node }, { initial_sigma } ),
+									  Matrix( 1, 1, 1 ) )
+			, GPPPCMRPLV( { sigma_node } )
+		{}
+
+		virtual ~G1PPPCMRPLV() {}
+
+	protected:
+		virtual GaussianFactorDynamics* clone() const override { return new G1PPPCMRPLV( *this ); }
+	};
+
+	class G2PPPCMRPLV : public Gaussian2FactorDynamics, public GPPPCMRPLV
+	{
+	public:
+		G2PPPCMRPLV( const Handle<YieldTermStructure>& termStructure,
+					 Real a,
+					 const RealVector& sigma_node,
+					 const RealVector& initial_sigma,
+					 Real b,
+					 const RealVector& eta_node,
+					 const RealVector& initial_eta,
+					 Real rho )
+			: GaussianFactorDynamics( termStructure,
+									  { IntegrableConstantParameter( a, PositiveConstraint() ), IntegrableConstantParameter( b, PositiveConstraint() ) },
+									  convertLinearParamVector( { sigma_node, eta_node }, { initial_sigma, initial_eta } ),
+									  getCorrelationMatrix( rho ) )
+			, GPPPCMRPLV( { sigma_node, eta_node } )
+		{}
+
+		virtual ~G2PPPCMRPLV() {}
+
+	protected:
+		virtual GaussianFactorDynamics* clone() const override { return new G2PPPCMRPLV( *this ); }
+	};
+}
+
+#endif // !CALIBRATOR_MODELS_SHORTRATE_DYNAMICS_GAUSSIANFACTOR_GPPCMR_PLV_HPP
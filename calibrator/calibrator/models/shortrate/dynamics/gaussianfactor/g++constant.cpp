@@ -2,6 +2,18 @@
 
 namespace HJCALIBRATOR
 {
+	void GPPConstantDynamics::sigma( const Parameter& sigma, Size i )
+	{
+		requireConstant( sigma );
+		GPPConstantMeanReversion::sigma( sigma, i );
+	}
+
+	void GPPConstantDynamics::rho( const Parameter& rho, Size i, Size j )
+	{
+		requireConstant( rho );
+		GPPConstantMeanReversion::rho( rho, i, j );
+	}
+
 	Real GPPConstantDynamics::meanTforward( Size i, Size j, Time T, Time s, Time t ) const
 	{
 		Real ai = a( i, 0.0 );
@@ -12,7 +24,7 @@ namespace HJCALIBRATOR
 		Real integral = (1 - exp( -ai * (t - s) )) / ai / aj
 			- (exp( -aj * (T - t) ) - exp( -aj * T - ai * t + (ai + aj)*s ) ) / (ai + aj) / aj;
 
-		Real val = sigmai * sigmaj * integral;
+		Real val = correlationMatrix()[i][j] * sigmai * sigmaj * integral;
 		return val;
 	}
 
@@ -23,7 +35,7 @@ namespace HJCALIBRATOR
 		Real aj = a( j, 0.0 );
 		Real sigmai = sigma( i, 0.0 );
 		Real sigmaj = sigma( j, 0.0 );
-		Real c = sigmai * sigmaj / ai / aj;
+		Real c = correlationMatrix()[i][j] * sigmai * sigmaj / ai / aj;
 
 		return c * (dt
 					 + (1 - exp( -(ai + aj) * dt )) / (ai + aj)
@@ -31,13 +43,83 @@ namespace HJCALIBRATOR
 					 - (1 - exp( -aj * dt )) / aj);
 	}
 
-	Real GPPConstantDynamics::variance( Size i, Size j, Time s, Time t ) const
+	void GPPConstantDynamics::variance( Size i, Size j, Time s, const TimeVector& t, RealVector& result ) const
 	{
 		Real asum = a( i, 0.0 ) + a( j, 0.0 );
+		Real c = correlationMatrix()[i][j] * sigma( i, 0.0 ) * sigma( j, 0.0 ) / asum;
+		Size n = t.size();
 
-		Real val = sigma( i, 0.0 )*sigma( j, 0.0 )*(1 - exp( - asum*(t - s) )) / asum;
-		return val;
+		result.resize( n );
+		Real* out = result.data();
+		const Time* end = t.data();
+
+		for ( Size k = 0; k < n; k++ )
+		{
+			out[k] = c * (1 - exp( -asum * (end[k] - s) ));
+		}
+	}
+
+	void GPPConstantDynamics::moments( Time s, Time t, Time T, Moments& result ) const
+	{
+		resizeMoments( result );
+
+		Size n = dimension();
+		Time dt = t - s;
+
+		// exp( -a_i (t - s) ) and exp( -a_i (T - t) ), computed once per factor
+		RealVector mr( n ), vol( n ), decay( n ), decayT( n );
+		for ( Size i = 0; i < n; i++ )
+		{
+			mr[i] = a( i, 0.0 );
+			vol[i] = sigma( i, 0.0 );
+			decay[i] = exp( -mr[i] * dt );
+			decayT[i] = exp( -mr[i] * (T - t) );
+		}
+
+		for ( Size i = 0; i < n; i++ )
+		{
+			for ( Size j = 0; j <= i; j++ )
+			{
+				Real c = correlationMatrix()[i][j] * vol[i] * vol[j];
+				Real asum = mr[i] + mr[j];
+				Real v = (1 - decay[i] * decay[j]) / asum;
+
+				result.variance[i][j] = result.variance[j][i] = c * v;
+				result.integralVariance[i][j] = result.integralVariance[j][i]
+					= c * (dt + v - (1 - decay[i]) / mr[i] - (1 - decay[j]) / mr[j]) / mr[i] / mr[j];
+				result.meanTforward[i][j] = c * ((1 - decay[i]) / mr[i] - decayT[j] * v) / mr[j];
+				result.meanTforward[j][i] = c * ((1 - decay[j]) / mr[j] - decayT[i] * v) / mr[i];
+			}
+		}
+
+		sumMeanTforward( result );
+	}
+
+	void GPPConstantDynamics::covariance( Time s, Time t, Matrix& result ) const
+	{
+		Size n = dimension();
+
+		if ( result.rows() != n || result.columns() != n )
+			result = Matrix( n, n );
+
+		RealVector mr( n ), vol( n ), decay( n );
+		for ( Size i = 0; i < n; i++ )
+		{
+			mr[i] = a( i, 0.0 );
+			vol[i] = sigma( i, 0.0 );
+			decay[i] = exp( -mr[i] * (t - s) );
+		}
+
+		for ( Size i = 0; i < n; i++ )
+		{
+			for ( Size j = 0; j <= i; j++ )
+			{
+				result[i][j] = result[j][i] = correlationMatrix()[i][j] * vol[i] * vol[j]
+					* (1 - decay[i] * decay[j]) / (mr[i] + mr[j]);
+			}
+		}
 	}
+
 	Real GPPConstantDynamics::phi( Size i, Size j, Time t ) const
 	{
 		Real a_i = a( i )(0.0);
@@ -46,10 +128,10 @@ namespace HJCALIBRATOR
 		Real sigma_i = sigma( i )(0.0);
 		Real sigma_j = sigma( j )(0.0);
 
-		Real integral = (1 - exp( -a_i * t )) / a_i / a_i
-			- (1 - exp( -(a_i + a_j) * t )) / a_i / a_j
-			+ (1 - exp( -a_j * t )) / a_j / a_j;
+		Real integral = ((1 - exp( -a_i * t ))
+						  - (1 - exp( -(a_i + a_j) * t ))
+						  + (1 - exp( -a_j * t ))) / a_i / a_j;
 
-		return sigma_i * sigma_j * integral;
+		return correlationMatrix()[i][j] * sigma_i * sigma_j * integral;
 	}
 }
\ No newline at end of file
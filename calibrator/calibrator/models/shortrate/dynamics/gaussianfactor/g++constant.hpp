@@ -19,11 +19,25 @@ namespace HJCALIBRATOR
 
 		virtual ~GPPConstantDynamics() {}
 
+		using GPPConstantMeanReversion::variance;
+		using GPPConstantMeanReversion::sigma;
+		using GPPConstantMeanReversion::rho;
+
+		//! The volatilities and the correlations stay constant, as the closed forms take them at time 0
+		virtual void sigma( const Parameter& sigma, Size i ) override;
+		virtual void rho( const Parameter& rho, Size i, Size j ) override;
+
 		virtual Real meanTforward( Size i, Size j, Time T, Time s, Time t ) const override;
 		virtual Real integralVariance( Size i, Size j, Time s, Time t ) const override;
 		virtual Real variance( Size i, Size j, Time s, Time t ) const override;
+		virtual void variance( Size i, Size j, Time s, const TimeVector& t, RealVector& result ) const override;
+
+		virtual void moments( Time s, Time t, Time T, Moments& result ) const override;
+		virtual void covariance( Time s, Time t, Matrix& result ) const override;
 
 	protected:
+		virtual GaussianFactorDynamics* clone() const override { return new GPPConstantDynamics( *this ); }
+
 		GPPConstantDynamics() {}
 
 		virtual Real phi( Size i, Size j, Time t ) const override;
@@ -36,11 +50,14 @@ namespace HJCALIBRATOR
 							Real a,
 							Real sigma )
 			: GaussianFactorDynamics( termStructure,
-									  { ConstantParameter( a, NoConstraint() ) },
+									  { IntegrableConstantParameter( a, NoConstraint() ) },
 									  { ConstantParameter( sigma , PositiveConstraint() ) },
 									  Matrix( 1, 1, 1 ) )
 		{}
 		virtual ~G1ConstantDynamics() {}
+
+	protected:
+		virtual GaussianFactorDynamics* clone() const override { return new G1ConstantDynamics( *this ); }
 	};
 
 	class G2ConstantDynamics : public Gaussian2FactorDynamics, public GPPConstantDynamics
@@ -51,12 +68,25 @@ namespace HJCALIBRATOR
 							Real b, Real eta,
 							Real rho )
 			: GaussianFactorDynamics( termStructure,
-									  { ConstantParameter( a, PositiveConstraint() ),  ConstantParameter( b, PositiveConstraint() ) },
+									  { IntegrableConstantParameter( a, PositiveConstraint() ),  IntegrableConstantParameter( b, PositiveConstraint() ) },
 									  { ConstantParameter( sigma, PositiveConstraint() ), ConstantParameter( eta, PositiveConstraint() ) },
 									  getCorrelationMatrix( rho ) )
 		{}
 		virtual ~G2ConstantDynamics() {}
+
+	protected:
+		virtual GaussianFactorDynamics* clone() const override { return new G2ConstantDynamics( *this ); }
 	};
+
+	// inline definitions
+
+	inline Real GPPConstantDynamics::variance( Size i, Size j, Time s, Time t ) const
+	{
+		Real asum = a( i, 0.0 ) + a( j, 0.0 );
+
+		Real val = correlationMatrix()[i][j]*sigma( i, 0.0 )*sigma( j, 0.0 )*(1 - exp( - asum*(t - s) )) / asum;
+		return val;
+	}
 }
 
 #endif // !CALIBRATOR_MODELS_SHORTRATE_DYNAMICS_GAUSSIANFACTOR_GPPCONSTANTDYNAMICS_HPP
@@ -2,27 +2,52 @@
 
 namespace HJCALIBRATOR
 {
-	ParamVector&& RealVectorToParamVector( const RealVector & a, Constraint constraint )
+	ParamVector RealVectorToParamVector( const RealVector & a, Constraint constraint )
 	{
 		ParamVector a_;
 
 		for ( Real ai : a )
 		{
-			a_.push_back( ConstantParameter( ai, constraint ) );
+			a_.push_back( IntegrableConstantParameter( ai, constraint ) );
 		}
 
-		return std::move( a_ );
+		return a_;
 	}
 
-	Real GPPConstantMeanReversion::E( Size i, Time s, Time t ) const
+	void GPPConstantMeanReversion::a( const Parameter& a, Size i )
 	{
-		return exp( a(i)(0.0) * (t - s) );
+		requireConstant( a );
+		GaussianFactorDynamics::a( a, i );
 	}
 
-	Real GPPConstantMeanReversion::B( Size i, Time s, Time t ) const
+	void GPPConstantMeanReversion::E( Size i, Time t, const TimeVector& T, RealVector& result ) const
 	{
 		Real aval = a( i )(0.0);
-		return (1 - exp( -aval * (t - s) )) / aval;
+		Size n = T.size();
+
+		result.resize( n );
+		Real* out = result.data();
+		const Time* end = T.data();
+
+		for ( Size k = 0; k < n; k++ )
+		{
+			out[k] = exp( aval * (end[k] - t) );
+		}
+	}
+
+	void GPPConstantMeanReversion::B( Size i, Time t, const TimeVector& T, RealVector& result ) const
+	{
+		Real aval = a( i )(0.0);
+		Size n = T.size();
+
+		result.resize( n );
+		Real* out = result.data();
+		const Time* end = T.data();
+
+		for ( Size k = 0; k < n; k++ )
+		{
+			out[k] = (1 - exp( -aval * (end[k] - t) )) / aval;
+		}
 	}
 
 	Real GPPConstantMeanReversion::integralVariance( Size i, Size j, Time s, Time t ) const
@@ -30,15 +55,16 @@ namespace HJCALIBRATOR
 		Real a_i = a( i, 0.0 );
 		Real a_j = a( j, 0.0 );
 
-		const Parameter& sigma_i = sigma( i );
-		const Parameter& sigma_j = sigma( j );
+		const ParameterSnapshot& sigma_i = sigmaSnapshot( i );
+		const ParameterSnapshot& sigma_j = sigmaSnapshot( j );
+		const ParameterSnapshot& rho_ij = rhoSnapshot( i, j );
 
-		auto integrand = [&, a_i, a_j, sigma_i, sigma_j, t]( Time u )
+		auto integrand = [&, a_i, a_j, t]( Time u )
 		{
-			return sigma_i( u ) * sigma_j( u ) * (1 - exp( -a_i * (t - u) )) * (1 - exp( -a_j * (t - u) )) / a_i / a_j;
+			return rho_ij( u ) * sigma_i( u ) * sigma_j( u ) * (1 - exp( -a_i * (t - u) )) * (1 - exp( -a_j * (t - u) )) / a_i / a_j;
 		};
 
-		return integrator_( integrand, s, t );
+		return integral( integrand, s, t );
 	}
 
 	Real GPPConstantMeanReversion::variance( Size i, Size j, Time s, Time t ) const
@@ -46,32 +72,34 @@ namespace HJCALIBRATOR
 		Real a_i = a( i, 0.0 );
 		Real a_j = a( j, 0.0 );
 
-		const Parameter& sigma_i = sigma(i);
-		const Parameter& sigma_j = sigma(j);
+		const ParameterSnapshot& sigma_i = sigmaSnapshot( i );
+		const ParameterSnapshot& sigma_j = sigmaSnapshot( j );
+		const ParameterSnapshot& rho_ij = rhoSnapshot( i, j );
 
-		auto integrand = [&, a_i, a_j, sigma_i, sigma_j, t]( Time u )
+		auto integrand = [&, a_i, a_j, t]( Time u )
 		{
-			return sigma_i( u ) * sigma_j( u ) * exp(  - ( a_i + a_j ) * (t - u) );
+			return rho_ij( u ) * sigma_i( u ) * sigma_j( u ) * exp(  - ( a_i + a_j ) * (t - u) );
 		};
 
-		return integrator_( integrand, s, t );
+		return integral( integrand, s, t );
 	}
 	Real GPPConstantMeanReversion::phi( Size i, Size j, Time t ) const
 	{
 		Real a_i = a( i )(0.0);
 		Real a_j = a( j )(0.0);
 
-		const Parameter& sigma_i = sigma( i );
-		const Parameter& sigma_j = sigma( j );
+		const ParameterSnapshot& sigma_i = sigmaSnapshot( i );
+		const ParameterSnapshot& sigma_j = sigmaSnapshot( j );
+		const ParameterSnapshot& rho_ij = rhoSnapshot( i, j );
 
-		auto integrand = [t, a_i, a_j, &sigma_i, &sigma_j](Time u)
+		auto integrand = [t, a_i, a_j, &sigma_i, &sigma_j, &rho_ij](Time u)
 		{
 			Real dt = t - u;
-			return sigma_i( u ) * sigma_j( u )
-				* ((exp( -a_i * dt ) - exp( -(a_i + a_j)*dt )) / a_i
-					+ (exp( -a_j * dt ) - exp( -(a_i + a_j)*dt ) / a_j));
+			return rho_ij( u ) * sigma_i( u ) * sigma_j( u )
+				* ((exp( -a_i * dt ) - exp( -(a_i + a_j)*dt )) / a_j
+					+ (exp( -a_j * dt ) - exp( -(a_i + a_j)*dt )) / a_i);
 		};
 
-		return integrator_( integrand, 0, t );
+		return integral( integrand, 0, t );
 	}
 }
@@ -1,11 +1,12 @@
 #ifndef CALIBRATOR_MODELS_SHORTRATE_DYNAMICS_GAUSSIANFACTOR_GPPCONSTANTMEANREVERSION_HPP
 #define CALIBRATOR_MODELS_SHORTRATE_DYNAMICS_GAUSSIANFACTOR_GPPCONSTANTMEANREVERSION_HPP
 
+#include <calibrator/models/parameters/integrableconstantparameter.hpp>
 #include <calibrator/models/shortrate/dynamics/gaussianfactordynamics.hpp>
 
 namespace HJCALIBRATOR
 {
-	ParamVector&& RealVectorToParamVector( const RealVector& a, Constraint constraint = NoConstraint() );
+	ParamVector RealVectorToParamVector( const RealVector& a, Constraint constraint = NoConstraint() );
 
 	class GPPConstantMeanReversion : public virtual GaussianFactorDynamics
 	{
@@ -20,16 +21,32 @@ namespace HJCALIBRATOR
 		virtual ~GPPConstantMeanReversion() {}
 
 
+		using GaussianFactorDynamics::a;
+		using GaussianFactorDynamics::E;
+		using GaussianFactorDynamics::B;
+		using GaussianFactorDynamics::variance;
+
+		//! The mean reversions stay constant
+		virtual void a( const Parameter& a, Size i ) override;
+
 		virtual Real E( Size i, Time s, Time t ) const;
 		virtual Real B( Size i, Time s, Time t ) const;
 
+		virtual void E( Size i, Time t, const TimeVector& T, RealVector& result ) const override;
+		virtual void B( Size i, Time t, const TimeVector& T, RealVector& result ) const override;
+
 		virtual Real integralVariance( Size i, Size j, Time s, Time t ) const override;
 		virtual Real variance( Size i, Size j, Time s, Time t ) const override;
 
 	protected:
+		virtual GaussianFactorDynamics* clone() const override { return new GPPConstantMeanReversion( *this ); }
+
 		GPPConstantMeanReversion() {}
 
 		virtual Real phi( Size i, Size j, Time t ) const;
+
+		virtual Real evaluateE( Size i, Time s, Time t ) const override { return GPPConstantMeanReversion::E( i, s, t ); }
+		virtual Real evaluateB( Size i, Time s, Time t ) const override { return GPPConstantMeanReversion::B( i, s, t ); }
 	};
 
 	class G1ConstantMeanReversionDynamics : public Gaussian1FactorDynamics, public GPPConstantMeanReversion
@@ -39,13 +56,29 @@ namespace HJCALIBRATOR
 										 Real a,
 										 const Parameter& sigma )
 			: GaussianFactorDynamics( termStructure,
-									  { ConstantParameter( a, NoConstraint() ) },
+									  { IntegrableConstantParameter( a, NoConstraint() ) },
 									  { sigma },
 									  Matrix( 1, 1, 1 ) )
 		{}
 
 		virtual ~G1ConstantMeanReversionDynamics() {}
+
+	protected:
+		virtual GaussianFactorDynamics* clone() const override { return new G1ConstantMeanReversionDynamics( *this ); }
 	};
+
+	// inline definitions, so that the statically dispatched pricers can inline the closed forms
+
+	inline Real GPPConstantMeanReversion::E( Size i, Time s, Time t ) const
+	{
+		return exp( a( i, 0.0 ) * (t - s) );
+	}
+
+	inline Real GPPConstantMeanReversion::B( Size i, Time s, Time t ) const
+	{
+		Real aval = a( i, 0.0 );
+		return (1 - exp( -aval * (t - s) )) / aval;
+	}
 }
 
 #endif // !CALIBRATOR_MODELS_SHORTRATE_DYNAMICS_GAUSSIANFACTOR_GPPCONSTANTMEANREVERSION_HPP
@@ -0,0 +1,185 @@
+#include <calibrator/models/shortrate/dynamics/gaussianfactor/g++tdmr_pcv.hpp>
+
+namespace HJCALIBRATOR
+{
+	Real GPPTDMRPCV::E( Size i, Time s, Time t ) const
+	{
+		const ParameterSnapshot& a_i = aSnapshot( i );
+		const RealVector& nodes = factor_nodes_[i];
+
+		RealVector::const_iterator it_nodes = std::upper_bound( nodes.begin(), nodes.end(), s );
+		RealVector::const_iterator it_last = std::lower_bound( nodes.begin(), nodes.end(), t );
+
+		Real intsum = 0;
+
+		Real begin = s;
+		for ( ; it_nodes < it_last; it_nodes++ )
+		{
+			Real end = *it_nodes;
+			intsum += a_i( (begin + end) / 2. ) * (end - begin);
+			begin = end;
+		}
+
+		intsum += a_i( (begin + t) / 2. ) * (t - begin);
+
+		return exp( intsum );
+	}
+
+	Real GPPTDMRPCV::B( Size i, Time s, Time t ) const
+	{
+		const ParameterSnapshot& a_i = aSnapshot( i );
+		const RealVector& nodes = factor_nodes_[i];
+
+		RealVector::const_iterator it_first = std::upper_bound( nodes.begin(), nodes.end(), s );
+		RealVector::const_iterator it_nodes = std::lower_bound( nodes.begin(), nodes.end(), t );
+
+		Real val = 0;
+
+		Real end = t;
+		while ( it_nodes > it_first )
+		{
+			it_nodes--;
+
+			Real begin = *it_nodes;
+			val = prependSegmentB( a_i( (begin + end) / 2. ), end - begin, val );
+			end = begin;
+		}
+
+		return prependSegmentB( a_i( (s + end) / 2. ), end - s, val );
+	}
+
+	SegmentPairIntegrals GPPTDMRPCV::pairIntegrals( Size i, Size j, Time s, Time t ) const
+	{
+		const ParameterSnapshot& a_i = aSnapshot( i );
+		const ParameterSnapshot& a_j = aSnapshot( j );
+		const ParameterSnapshot& sigma_i = sigmaSnapshot( i );
+		const ParameterSnapshot& sigma_j = sigmaSnapshot( j );
+		const ParameterSnapshot& rho_ij = rhoSnapshot( i, j );
+
+		const RealVector& nodes = combined_nodes_[i][j];
+
+		RealVector::const_iterator it_nodes = std::upper_bound( nodes.begin(), nodes.end(), s );
+		RealVector::const_iterator it_last = std::lower_bound( nodes.begin(), nodes.end(), t );
+
+		SegmentPairIntegrals integrals;
+
+		Real begin = s;
+		for ( ; it_nodes < it_last; it_nodes++ )
+		{
+			Real end = *it_nodes;
+			Real mid = (begin + end) / 2.;
+
+			integrals.advance( a_i( mid ), a_j( mid ), rho_ij( mid ) * sigma_i( mid ) * sigma_j( mid ), end - begin );
+			begin = end;
+		}
+
+		Real mid = (begin + t) / 2.;
+		integrals.advance( a_i( mid ), a_j( mid ), rho_ij( mid ) * sigma_i( mid ) * sigma_j( mid ), t - begin );
+
+		return integrals;
+	}
+
+	Real GPPTDMRPCV::meanTforward( Size i, Size j, Time T, Time s, Time t ) const
+	{
+		SegmentPairIntegrals integrals = pairIntegrals( i, j, s, t );
+
+		return B( j, t, T ) * integrals.v + integrals.Mij;
+	}
+
+	Real GPPTDMRPCV::integralVariance( Size i, Size j, Time s, Time t ) const
+	{
+		return pairIntegrals( i, j, s, t ).J;
+	}
+
+	Real GPPTDMRPCV::variance( Size i, Size j, Time s, Time t ) const
+	{
+		return pairIntegrals( i, j, s, t ).v;
+	}
+
+	Real GPPTDMRPCV::phi( Size i, Size j, Time t ) const
+	{
+		SegmentPairIntegrals integrals = pairIntegrals( i, j, 0, t );
+
+		return integrals.Mij + integrals.Mji;
+	}
+
+	void GPPTDMRPCV::a( const Parameter& a, Size i )
+	{
+		requirePiecewiseConstant( a );
+		GaussianFactorDynamics::a( a, i );
+
+		mergeNodes( i );
+	}
+
+	void GPPTDMRPCV::sigma( const Parameter& sigma, Size i )
+	{
+		requirePiecewiseConstant( sigma );
+		GaussianFactorDynamics::sigma( sigma, i );
+
+		mergeNodes( i );
+	}
+
+	void GPPTDMRPCV::rho( const Parameter& rho, Size i, Size j )
+	{
+		requirePiecewiseConstant( rho );
+		GaussianFactorDynamics::rho( rho, i, j );
+
+		mergeNodes( i, j );
+	}
+
+	void GPPTDMRPCV::mergeNodes( Size i )
+	{
+		mergeTimes( { &aSnapshot( i ), &sigmaSnapshot( i ) }, factor_nodes_[i] );
+
+		for ( Size j = 0; j < dimension(); j++ )
+		{
+			mergeNodes( i, j );
+		}
+	}
+
+	void GPPTDMRPCV::mergeNodes( Size i, Size j )
+	{
+		RealVector& nodes = combined_nodes_[i][j];
+		mergeTimes( { &aSnapshot( i ), &sigmaSnapshot( i ), &aSnapshot( j ), &sigmaSnapshot( j ), &rhoSnapshot( i, j ) }, nodes );
+
+		combined_nodes_[j][i] = nodes;
+	}
+
+	void GPPTDMRPCV::combineNodes( const std::vector<RealVector>& a_nodes,
+								   const std::vector<RealVector>& sigma_nodes )
+	{
+		QL_REQUIRE( a_nodes.size() == sigma_nodes.size(),
+					"Mean reversion and volatility node dimensions mismatched." );
+
+		Size dim = a_nodes.size();
+
+		factor_nodes_.resize( dim );
+
+		for ( Size i = 0; i < dim; i++ )
+		{
+			RealVector& nodes = factor_nodes_[i];
+			nodes.reserve( a_nodes[i].size() + sigma_nodes[i].size() );
+			nodes.insert( nodes.end(), a_nodes[i].begin(), a_nodes[i].end() );
+			nodes.insert( nodes.end(), sigma_nodes[i].begin(), sigma_nodes[i].end() );
+
+			std::sort( nodes.begin(), nodes.end() );
+			nodes.erase( unique( nodes.begin(), nodes.end() ), nodes.end() );
+		}
+
+		combined_nodes_.resize( dim, std::vector<RealVector>( dim ) );
+
+		for ( Size i = 0; i < dim; i++ )
+		{
+			for ( Size j = 0; j < dim; j++ )
+			{
+				RealVector& nodeij = combined_nodes_[i][j];
+				nodeij.reserve( factor_nodes_[i].size() + factor_nodes_[j].size() );
+				nodeij.insert( nodeij.end(), factor_nodes_[i].begin(), factor_nodes_[i].end() );
+				nodeij.insert( nodeij.end(), factor_nodes_[j].begin(), factor_nodes_[j].end() );
+
+				std::sort( nodeij.begin(), nodeij.end() );
+				nodeij.erase( unique( nodeij.begin(), nodeij.end() ), nodeij.end() );
+			}
+		}
+	}
+}
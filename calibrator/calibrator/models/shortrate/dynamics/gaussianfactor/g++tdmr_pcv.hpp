@@ -0,0 +1,132 @@
+#ifndef CALIBRATOR_MODELS_SHORTRATE_DYNAMICS_GAUSSIANFACTOR_GPPTDMR_PCV_HPP
+#define CALIBRATOR_MODELS_SHORTRATE_DYNAMICS_GAUSSIANFACTOR_GPPTDMR_PCV_HPP
+
+#include <calibrator/models/shortrate/dynamics/gaussianfactor/g++cmr_pcv.hpp>
+#include <calibrator/models/shortrate/dynamics/segmentintegrals.hpp>
+
+namespace HJCALIBRATOR
+{
+	//! Gaussian factor dynamics with piecewise-constant mean reversions and volatilities
+	/*! Both \f$ a_i(t) \f$ and \f$ \sigma_i(t) \f$ are piecewise constant. The nodes of
+	\f$ a_i \f$ and \f$ \sigma_i \f$ are merged per factor, and the factor node sets are merged
+	per pair of factors, so that every function is a sum of exact segment contributions
+	without any numerical integration.
+	*/
+	class GPPTDMRPCV : public virtual GaussianFactorDynamics
+	{
+		std::vector<RealVector> factor_nodes_;
+		std::vector<std::vector<RealVector>> combined_nodes_;
+
+	public:
+		GPPTDMRPCV( const Handle<YieldTermStructure>& termStructure,
+					const std::vector<RealVector>& a_nodes,
+					const std::vector<RealVector>& initial_a,
+					const std::vector<RealVector>& sigma_nodes,
+					const std::vector<RealVector>& initial_sigma,
+					const Matrix& rho )
+			: GaussianFactorDynamics( termStructure,
+									  convertParamVector( a_nodes, initial_a ),
+									  convertParamVector( sigma_nodes, initial_sigma ),
+									  rho )
+		{
+			combineNodes( a_nodes, sigma_nodes );
+		}
+
+		virtual ~GPPTDMRPCV() {}
+
+		using GaussianFactorDynamics::a;
+		using GaussianFactorDynamics::sigma;
+		using GaussianFactorDynamics::rho;
+		using GaussianFactorDynamics::E;
+		using GaussianFactorDynamics::B;
+		using GaussianFactorDynamics::variance;
+
+		//! The nodes of the factor and of its pairs are merged again with the nodes of the new mean reversion
+		virtual void a( const Parameter& a, Size i ) override;
+		//! Same as above for a piecewise constant volatility
+		virtual void sigma( const Parameter& sigma, Size i ) override;
+		//! The nodes of the pair are merged again with the nodes of the new correlation
+		virtual void rho( const Parameter& rho, Size i, Size j ) override;
+
+		virtual Real E( Size i, Time s, Time t ) const override;
+		virtual Real B( Size i, Time s, Time t ) const override;
+
+		virtual Real meanTforward( Size i, Size j, Time T, Time s, Time t ) const override;
+		virtual Real integralVariance( Size i, Size j, Time s, Time t ) const override;
+		virtual Real variance( Size i, Size j, Time s, Time t ) const override;
+
+	protected:
+		virtual GaussianFactorDynamics* clone() const override { return new GPPTDMRPCV( *this ); }
+
+		GPPTDMRPCV( const std::vector<RealVector>& a_nodes,
+					const std::vector<RealVector>& sigma_nodes )
+		{
+			combineNodes( a_nodes, sigma_nodes );
+		}
+
+		virtual Real phi( Size i, Size j, Time t ) const override;
+
+		virtual Real evaluateE( Size i, Time s, Time t ) const override { return GPPTDMRPCV::E( i, s, t ); }
+		virtual Real evaluateB( Size i, Time s, Time t ) const override { return GPPTDMRPCV::B( i, s, t ); }
+
+	private:
+		void combineNodes( const std::vector<RealVector>& a_nodes,
+						   const std::vector<RealVector>& sigma_nodes );
+
+		//! Nodes of the factor i and of all its pairs from the snapshots of the parameters
+		void mergeNodes( Size i );
+		//! Nodes of the pair (i,j) from the snapshots of the parameters of both factors and of the correlation
+		void mergeNodes( Size i, Size j );
+
+		SegmentPairIntegrals pairIntegrals( Size i, Size j, Time s, Time t ) const;
+	};
+
+	class G1PPTDMRPCV : public Gaussian1FactorDynamics, public GPPTDMRPCV
+	{
+	public:
+		G1PPTDMRPCV( const Handle<YieldTermStructure>& termStructure,
+					 const RealVector& a_node,
+					 const RealVector& initial_a,
+					 const RealVector& sigma_node,
+					 const RealVector& initial_sigma )
+			: GaussianFactorDynamics( termStructure,
+									  convertParamVector( { a_node }, { initial_a } ),
+									  convertParamVector( { sigma_node }, { initial_sigma } ),
+									  Matrix( 1, 1, 1 ) )
+			, GPPTDMRPCV( { a_node }, { sigma_node } )
+		{}
+
+		virtual ~G1PPTDMRPCV() {}
+
+	protected:
+		virtual GaussianFactorDynamics* clone() const override { return new G1PPTDMRPCV( *this ); }
+	};
+
+	class G2PPTDMRPCV : public Gaussian2FactorDynamics, public GPPTDMRPCV
+	{
+	public:
+		G2PPTDMRPCV( const Handle<YieldTermStructure>& termStructure,
+					 const RealVector& a_node,
+					 const RealVector& initial_a,
+					 const RealVector& sigma_node,
+					 const RealVector& initial_sigma,
+					 const RealVector& b_node,
+					 const RealVector& initial_b,
+					 const RealVector& eta_node,
+					 const RealVector& initial_eta,
+					 Real rho )
+			: GaussianFactorDynamics( termStructure,
+									  convertParamVector( { a_node, b_node }, { initial_a, initial_b } ),
+									  convertParamVector( { sigma_node, eta_node }, { initial_sigma, initial_eta } ),
+									  getCorrelationMatrix( rho ) )
+			, GPPTDMRPCV( { a_node, b_node }, { sigma_node, eta_node } )
+		{}
+
+		virtual ~G2PPTDMRPCV() {}
+
+	protected:
+		virtual GaussianFactorDynamics* clone() const override { return new G2PPTDMRPCV( *this ); }
+	};
+}
+
+#endif // !CALIBRATOR_MODELS_SHORTRATE_DYNAMICS_GAUSSIANFACTOR_GPPTDMR_PCV_HPP
@@ -1,3 +1,7 @@
+#include <algorithm>
+#include <typeinfo>
+
+#include <calibrator/math/integrals/integratorcopy.hpp>
 #include <calibrator/models/shortrate/dynamics/gaussianfactordynamics.hpp>
 
 namespace HJCALIBRATOR
@@ -5,10 +9,14 @@ namespace HJCALIBRATOR
 	GaussianFactorDynamics::GaussianFactorDynamics( const Handle<YieldTermStructure>& termStructure,
 													const ParamVector& a,
 													const ParamVector& sigma,
-													const Matrix& rho )
+													const Matrix& rho,
+													const shared_ptr<Integrator>& integrator )
 		: termStructure_( termStructure )
 		, a_( a ), sigma_( sigma )
-		, integrator_( GaussKronrodAdaptive( 0.01, 10000 ) )
+		, integrator_( integrator ? integrator : defaultIntegrator() )
+		, frozen_( false )
+		, cacheEnabled_( false ), cacheCapacity_( 0 ), version_( 0 ), cacheVersion_( 0 )
+		, cumulativeEnabled_( false ), cumulativeHorizon_( 0 ), cumulativeSteps_( 0 ), cumulativeVersion_( 0 )
 	{
 		QL_REQUIRE( a.size() == sigma.size(),
 					"The number of a and sigma does not coinciede." );
@@ -20,81 +28,415 @@ namespace HJCALIBRATOR
 					"The correlation matrix provided is not square matrix." );
 
 		setupCorrelMatrix( rho );
+
+		for ( Size i = 0; i < a_.size(); i++ )
+		{
+			aSnapshot_.push_back( ParameterSnapshot( a_[i] ) );
+			sigmaSnapshot_.push_back( ParameterSnapshot( sigma_[i] ) );
+		}
+	}
+
+	shared_ptr<Integrator> GaussianFactorDynamics::defaultIntegrator()
+	{
+		return shared_ptr<Integrator>( new GaussKronrodAdaptive( 0.01, 10000 ) );
+	}
+
+	void GaussianFactorDynamics::integrator( const shared_ptr<Integrator>& integrator )
+	{
+		QL_REQUIRE( integrator, "Null integrator given to the gaussian factor dynamics." );
+		checkNotFrozen();
+
+		integrator_ = integrator;
+		parametersChanged();
 	}
 
 	void GaussianFactorDynamics::setupCorrelMatrix( const Matrix& rho )
 	{
-		for ( Size i = 0; i < rho.rows(); i++ )
+		Size n = rho.rows();
+
+		rho_.assign( n * (n + 1) / 2, Parameter() );
+		rhoSnapshot_.assign( n * (n + 1) / 2, ParameterSnapshot() );
+		correlation_ = Matrix( n, n, 0.0 );
+
+		for ( Size i = 0; i < n; i++ )
 		{
-			for ( Size j = i; j < rho.columns(); j++ )
+			for ( Size j = i; j < n; j++ )
 			{
-				rho_[std::minmax(i,j)] = ConstantParameter( rho[i][j], BoundaryConstraint( -1, 1 ) );
+				rho_[correlationIndex( i, j )] = IntegrableConstantParameter( rho[i][j], BoundaryConstraint( -1, 1 ) );
+				updateCorrelationMatrix( i, j );
 			}
 		}
 	}
 
+	void GaussianFactorDynamics::updateCorrelationMatrix( Size i, Size j )
+	{
+		rhoSnapshot_[correlationIndex( i, j )] = ParameterSnapshot( rho_[correlationIndex( i, j )] );
+		correlation_[i][j] = correlation_[j][i] = rhoSnapshot_[correlationIndex( i, j )]( 0.0 );
+	}
+
 	void GaussianFactorDynamics::a( const Parameter& a, Size i )
 	{
-		QL_ENSURE( i < a_.size()+1,
+		QL_ENSURE( i < a_.size(),
 				   "Memory for the " << i << "-th mean reversion parameter is not allocated" );
+		checkNotFrozen();
 		
 		a_[i] = a;
+		aSnapshot_[i] = ParameterSnapshot( a );
+		parametersChanged();
 	}
 
 	void GaussianFactorDynamics::sigma( const Parameter& sigma, Size i )
 	{
-		QL_ENSURE( i < sigma_.size() + 1,
+		QL_ENSURE( i < sigma_.size(),
 				   "Memory for the " << i << "-th volatility parameter is not allocated" );
+		checkNotFrozen();
 		
 		sigma_[i] = sigma;
+		sigmaSnapshot_[i] = ParameterSnapshot( sigma );
+		parametersChanged();
 	}
 
 	void GaussianFactorDynamics::rho( const Parameter& rho, Size i, Size j )
 	{
-		rho_[std::minmax( i, j )] = rho;
+		QL_ENSURE( correlationIndex( i, j ) < rho_.size(),
+				   "Memory for the (" << i << "," << j << ")-th correlation parameter is not allocated" );
+		checkNotFrozen();
+
+		rho_[correlationIndex( i, j )] = rho;
+		updateCorrelationMatrix( i, j );
+		parametersChanged();
 	}
 
-	Parameter GaussianFactorDynamics::rho( Size i, Size j ) const
+	void GaussianFactorDynamics::requireConstant( const Parameter& parameter )
 	{
-		auto it = rho_.find( std::minmax( i, j ) );
+		QL_REQUIRE( parameter.size() == 1 && ParameterSnapshot( parameter ).times().empty(),
+					"The parameter must be constant." );
+	}
 
-		QL_ENSURE( it != rho_.end(),
-				   "(" << i << "," << " j)-th correlation factor not found." );
+	void GaussianFactorDynamics::requirePiecewiseConstant( const Parameter& parameter )
+	{
+		ParameterSnapshot::Kind kind = ParameterSnapshot( parameter ).kind();
+		QL_REQUIRE( kind == ParameterSnapshot::Constant || kind == ParameterSnapshot::PiecewiseConstant,
+					"The parameter must be constant or piecewise constant." );
+	}
 
-		return it->second;
+	void GaussianFactorDynamics::mergeTimes( std::initializer_list<const ParameterSnapshot*> snapshots, RealVector& nodes )
+	{
+		nodes.clear();
+
+		for ( const ParameterSnapshot* snapshot : snapshots )
+		{
+			nodes.insert( nodes.end(), snapshot->times().begin(), snapshot->times().end() );
+		}
+
+		std::sort( nodes.begin(), nodes.end() );
+		nodes.erase( std::unique( nodes.begin(), nodes.end() ), nodes.end() );
+	}
+
+	ParameterAccess GaussianFactorDynamics::rho( Size i, Size j ) const
+	{
+		QL_ENSURE( correlationIndex( i, j ) < rho_.size(),
+				   "(" << i << "," << j << ")-th correlation factor not found." );
+
+		return rho_[correlationIndex( i, j )];
+	}
+
+	void GaussianFactorDynamics::enableCache( bool enable, Size capacity )
+	{
+		QL_REQUIRE( !enable || capacity > 0, "The capacity of the cache must be positive." );
+		checkNotFrozen();
+
+		cacheEnabled_ = enable;
+		cacheCapacity_ = capacity;
+
+		cacheE_.clear();
+		cacheB_.clear();
+		cacheA_.clear();
+	}
+
+	void GaussianFactorDynamics::checkCacheVersion() const
+	{
+		if ( cacheVersion_ != version_ || cacheE_.size() != dimension() )
+		{
+			cacheE_.assign( dimension(), TimePairCache() );
+			cacheB_.assign( dimension(), TimePairCache() );
+			cacheA_.clear();
+			cacheVersion_ = version_;
+		}
+	}
+
+	void GaussianFactorDynamics::enableCumulativeIntegrals( bool enable, Time horizon, Size steps )
+	{
+		checkNotFrozen();
+
+		cumulativeEnabled_ = enable;
+		cumulativeHorizon_ = horizon;
+		cumulativeSteps_ = steps;
+
+		cumulative_.reset();
+	}
+
+	shared_ptr<const GaussianFactorDynamics> GaussianFactorDynamics::freeze() const
+	{
+		shared_ptr<GaussianFactorDynamics> copy( clone() );
+
+		QL_ENSURE( typeid(*copy) == typeid(*this),
+				   "clone() is not overridden by " << typeid(*this).name() << ", which cannot be frozen." );
+
+		// each call of the copy integrates on its own copy of the rule, see integral()
+		copy->integrator_ = copyIntegrator( *integrator_ );
+		QL_REQUIRE( copy->integrator_,
+					"The integrator " << typeid(*integrator_).name() << " cannot be copied, so the dynamics cannot be frozen." );
+
+		copy->enableCache( false );
+		copy->precompute();
+		copy->frozen_ = true;
+
+		return copy;
+	}
+
+	Real GaussianFactorDynamics::integral( const boost::function<Real( Real )>& f, Time s, Time t ) const
+	{
+		return frozen_ ? integrateOnCopy( *integrator_, f, s, t ) : (*integrator_)( f, s, t );
+	}
+
+	void GaussianFactorDynamics::precompute() const
+	{
+		cumulativeIntegrals();
+	}
+
+	const CumulativeIntegralTable* GaussianFactorDynamics::cumulativeIntegrals() const
+	{
+		if ( !cumulativeEnabled_ )
+			return nullptr;
+
+		if ( !cumulative_ || cumulativeVersion_ != version_ )
+		{
+			cumulative_.reset( new CumulativeIntegralTable( *this, cumulativeHorizon_, cumulativeSteps_ ) );
+			cumulativeVersion_ = version_;
+		}
+
+		return cumulative_.get();
 	}
 
 	Real GaussianFactorDynamics::E( Size i, Time t, Time T ) const
 	{
-		Parameter a = a_[i];
-		auto lambda = [&a]( Time u )
+		if ( const CumulativeIntegralTable* table = cumulativeIntegrals() )
+			return table->E( i, t, T );
+
+		if ( !cacheEnabled_ )
+			return evaluateE( i, t, T );
+
+		checkCacheVersion();
+
+		auto key = std::make_pair( t, T );
+		auto it = cacheE_[i].find( key );
+		if ( it != cacheE_[i].end() )
+			return it->second;
+
+		Real val = evaluateE( i, t, T );
+		if ( cacheE_[i].size() >= cacheCapacity_ )
+			cacheE_[i].clear();
+
+		cacheE_[i].insert( std::make_pair( key, val ) );
+
+		return val;
+	}
+
+	Real GaussianFactorDynamics::B( Size i, Time t, Time T ) const
+	{
+		if ( const CumulativeIntegralTable* table = cumulativeIntegrals() )
+			return table->B( i, t, T );
+
+		if ( !cacheEnabled_ )
+			return evaluateB( i, t, T );
+
+		checkCacheVersion();
+
+		auto key = std::make_pair( t, T );
+		auto it = cacheB_[i].find( key );
+		if ( it != cacheB_[i].end() )
+			return it->second;
+
+		Real val = evaluateB( i, t, T );
+		if ( cacheB_[i].size() >= cacheCapacity_ )
+			cacheB_[i].clear();
+
+		cacheB_[i].insert( std::make_pair( key, val ) );
+
+		return val;
+	}
+
+	Real GaussianFactorDynamics::evaluateE( Size i, Time t, Time T ) const
+	{
+		const Parameter& a = a_[i];
+
+		Real val;
+		if ( !integrate( a, t, T, val ) )
 		{
-			return a( u );
-		};
+			auto lambda = [&a]( Time u )
+			{
+				return a( u );
+			};
+
+			val = integral( lambda, t, T );
+		}
 
-		Real val = integrator_( lambda, t, T );
 		return exp( val );
 	}
 
-	Real GaussianFactorDynamics::B( Size i, Time t, Time T ) const
+	Real GaussianFactorDynamics::evaluateB( Size i, Time t, Time T ) const
 	{
+		// evaluated directly, the abscissas would otherwise fill the memoization of E
 		auto lambda = [&, t, T]( Time u )
 		{
-			return 1 / E( i, t, u );
+			return 1 / evaluateE( i, t, u );
 		};
 
-		return integrator_( lambda, t, T );
+		return integral( lambda, t, T );
 	}
 
 	Real GaussianFactorDynamics::A( Time t, Time T ) const
 	{
+		AffineMoments buffer;
+		const AffineMoments& moments = affineMoments( t, buffer );
+
+		RealVector B_tT( dimension() );
+		for ( Size i = 0; i < dimension(); i++ )
+		{
+			B_tT[i] = B( i, t, T );
+		}
+
 		Real discount_t = termStructure_->discount( t );
 		Real discount_T = termStructure_->discount( T );
-		Real exponent = integralVariance( 0, T ) - integralVariance( t, T ) - integralVariance( 0, t );
+		Real exponent = affineExponent( moments, B_tT );
 
 		return discount_T / discount_t * exp( -0.5 * exponent );
 	}
 
+	void GaussianFactorDynamics::E( Size i, Time t, const TimeVector& T, RealVector& result ) const
+	{
+		result.resize( T.size() );
+
+		for ( Size k = 0; k < T.size(); k++ )
+		{
+			result[k] = E( i, t, T[k] );
+		}
+	}
+
+	void GaussianFactorDynamics::B( Size i, Time t, const TimeVector& T, RealVector& result ) const
+	{
+		result.resize( T.size() );
+
+		for ( Size k = 0; k < T.size(); k++ )
+		{
+			result[k] = B( i, t, T[k] );
+		}
+	}
+
+	void GaussianFactorDynamics::variance( Size i, Size j, Time s, const TimeVector& t, RealVector& result ) const
+	{
+		result.resize( t.size() );
+
+		for ( Size k = 0; k < t.size(); k++ )
+		{
+			result[k] = variance( i, j, s, t[k] );
+		}
+	}
+
+	void GaussianFactorDynamics::A( Time t, const TimeVector& T, RealVector& result ) const
+	{
+		result.resize( T.size() );
+
+		AffineMoments buffer;
+		const AffineMoments& moments = affineMoments( t, buffer );
+
+		std::vector<RealVector> strips( dimension() );
+		for ( Size i = 0; i < dimension(); i++ )
+		{
+			B( i, t, T, strips[i] );
+		}
+
+		Real discount_t = termStructure_->discount( t );
+		RealVector Bk( dimension() );
+
+		for ( Size k = 0; k < T.size(); k++ )
+		{
+			for ( Size i = 0; i < dimension(); i++ )
+			{
+				Bk[i] = strips[i][k];
+			}
+
+			Real exponent = affineExponent( moments, Bk );
+
+			result[k] = termStructure_->discount( T[k] ) / discount_t * exp( -0.5 * exponent );
+		}
+	}
+
+	const GaussianFactorDynamics::AffineMoments& GaussianFactorDynamics::affineMoments( Time t, AffineMoments& buffer ) const
+	{
+		if ( !cacheEnabled_ )
+		{
+			evaluateAffineMoments( t, buffer );
+			return buffer;
+		}
+
+		checkCacheVersion();
+
+		auto it = cacheA_.find( t );
+		if ( it == cacheA_.end() )
+		{
+			if ( cacheA_.size() >= cacheCapacity_ )
+				cacheA_.clear();
+
+			it = cacheA_.insert( std::make_pair( t, AffineMoments() ) ).first;
+			evaluateAffineMoments( t, it->second );
+		}
+
+		return it->second;
+	}
+
+	void GaussianFactorDynamics::evaluateAffineMoments( Time t, AffineMoments& moments ) const
+	{
+		Size npairs = dimension() * (dimension() + 1) / 2;
+
+		moments.v.resize( npairs );
+		moments.Mij.resize( npairs );
+		moments.Mji.resize( npairs );
+
+		for ( Size i = 0; i < dimension(); i++ )
+		{
+			for ( Size j = 0; j <= i; j++ )
+			{
+				Size p = correlationIndex( i, j );
+
+				// B_j(t,t) = 0, so the T-forward mean at T = t reduces to M_ij
+				moments.v[p] = variance( i, j, 0, t );
+				moments.Mij[p] = meanTforward( i, j, t, 0, t );
+				moments.Mji[p] = j == i ? moments.Mij[p] : meanTforward( j, i, t, 0, t );
+			}
+		}
+	}
+
+	Real GaussianFactorDynamics::affineExponent( const AffineMoments& moments, const RealVector& B ) const
+	{
+		Real intsum = 0;
+
+		for ( Size i = 0; i < dimension(); i++ )
+		{
+			for ( Size j = 0; j <= i; j++ )
+			{
+				Size p = correlationIndex( i, j );
+				Real integ = B[i] * B[j] * moments.v[p] + B[i] * moments.Mij[p] + B[j] * moments.Mji[p];
+
+				if ( j == i ) intsum += integ;
+				else intsum += 2 * integ;
+			}
+		}
+
+		return intsum;
+	}
+
 	Real GaussianFactorDynamics::phi( Time t ) const
 	{
 		Rate forwardRate = termStructure_->forwardRate( t, t, Continuous, NoFrequency );
@@ -108,7 +450,7 @@ namespace HJCALIBRATOR
 				Real integ = phi( i, j, t );
 
 				if ( j == i ) intsum += 0.5 * integ;
-				else intsum += rho(i,j)(0.0) * integ;
+				else intsum += integ;
 			}
 		}
 
@@ -126,7 +468,7 @@ namespace HJCALIBRATOR
 				Real integ = variance( i, j, s, t );
 
 				if ( j == i ) intsum += integ;
-				else intsum += 2 * rho(i,j)(0.0) * integ;
+				else intsum += 2 * integ;
 			}
 		}
 
@@ -144,7 +486,7 @@ namespace HJCALIBRATOR
 				Real integ = integralVariance( i, j, s, t );
 
 				if ( j == i ) intsum += integ;
-				else intsum += 2 * rho(i,j)(0.0) * integ;
+				else intsum += 2 * integ;
 			}
 		}
 
@@ -156,7 +498,7 @@ namespace HJCALIBRATOR
 		Real intsum = 0;
 		for ( Size j = 0; j < dimension(); j++ )
 		{
-			intsum += rho(i,j)(0.0) * meanTforward( i, j, T, s, t );
+			intsum += meanTforward( i, j, T, s, t );
 		}
 
 		return - intsum;
@@ -164,66 +506,155 @@ namespace HJCALIBRATOR
 
 	Real GaussianFactorDynamics::meanTforward( Size i, Size j, Time T, Time s, Time t ) const
 	{
-		const Parameter& a_i = a_[i];
-		const Parameter& a_j = a_[j];
+		if ( const CumulativeIntegralTable* table = cumulativeIntegrals() )
+			return table->meanTforward( i, j, T, s, t );
+
+		const ParameterSnapshot& a_i = aSnapshot_[i];
+		const ParameterSnapshot& a_j = aSnapshot_[j];
 
-		const Parameter& sigma_i = sigma_[i];
-		const Parameter& sigma_j = sigma_[j];
+		const ParameterSnapshot& sigma_i = sigmaSnapshot_[i];
+		const ParameterSnapshot& sigma_j = sigmaSnapshot_[j];
+		const ParameterSnapshot& rho_ij = rhoSnapshot( i, j );
 
+		// E and B evaluated directly, the abscissas would otherwise fill their memoization
 		auto integrand = [&, T]( Time u )
 		{
-			return sigma_i( u ) * sigma_j( u ) * B( j, u, T ) / E(i, u, t);
+			return rho_ij( u ) * sigma_i( u ) * sigma_j( u ) * evaluateB( j, u, T ) / evaluateE( i, u, t );
 		};
 
-		return integrator_( integrand, s, t );
+		return integral( integrand, s, t );
 	}
 
 	Real GaussianFactorDynamics::integralVariance( Size i, Size j, Time s, Time t ) const
 	{
-		const Parameter& a_i = a_[i];
-		const Parameter& a_j = a_[j];
+		if ( const CumulativeIntegralTable* table = cumulativeIntegrals() )
+			return table->integralVariance( i, j, s, t );
 
-		const Parameter& sigma_i = sigma_[i];
-		const Parameter& sigma_j = sigma_[j];
+		const ParameterSnapshot& a_i = aSnapshot_[i];
+		const ParameterSnapshot& a_j = aSnapshot_[j];
+
+		const ParameterSnapshot& sigma_i = sigmaSnapshot_[i];
+		const ParameterSnapshot& sigma_j = sigmaSnapshot_[j];
+		const ParameterSnapshot& rho_ij = rhoSnapshot( i, j );
 
 		auto integrand = [&, t]( Time u )
 		{
-			return sigma_i( u ) * sigma_j( u ) * B( i, j, u, t );
+			return rho_ij( u ) * sigma_i( u ) * sigma_j( u ) * evaluateB( i, u, t ) * evaluateB( j, u, t );
 		};
 
-		return integrator_( integrand, s, t );
+		return integral( integrand, s, t );
 	}
 
 	Real GaussianFactorDynamics::variance( Size i, Size j, Time s, Time t ) const
 	{
-		const Parameter& a_i = a_[i];
-		const Parameter& a_j = a_[j];
+		if ( const CumulativeIntegralTable* table = cumulativeIntegrals() )
+			return table->variance( i, j, s, t );
+
+		const ParameterSnapshot& a_i = aSnapshot_[i];
+		const ParameterSnapshot& a_j = aSnapshot_[j];
 
-		const Parameter& sigma_i = sigma_[i];
-		const Parameter& sigma_j = sigma_[j];
+		const ParameterSnapshot& sigma_i = sigmaSnapshot_[i];
+		const ParameterSnapshot& sigma_j = sigmaSnapshot_[j];
+		const ParameterSnapshot& rho_ij = rhoSnapshot( i, j );
 
 		auto integrand = [&, t]( Time u )
 		{
-			return sigma_i( u ) * sigma_j( u ) / E( i, j, u, t );
+			return rho_ij( u ) * sigma_i( u ) * sigma_j( u ) / (evaluateE( i, u, t ) * evaluateE( j, u, t ));
 		};
 
-		return integrator_( integrand, s, t );
+		return integral( integrand, s, t );
+	}
+
+	void GaussianFactorDynamics::moments( Time s, Time t, Time T, Moments& result ) const
+	{
+		resizeMoments( result );
+
+		for ( Size i = 0; i < dimension(); i++ )
+		{
+			for ( Size j = 0; j <= i; j++ )
+			{
+				result.variance[i][j] = result.variance[j][i] = variance( i, j, s, t );
+				result.integralVariance[i][j] = result.integralVariance[j][i] = integralVariance( i, j, s, t );
+				result.meanTforward[i][j] = meanTforward( i, j, T, s, t );
+				result.meanTforward[j][i] = i == j ? result.meanTforward[i][j] : meanTforward( j, i, T, s, t );
+			}
+		}
+
+		sumMeanTforward( result );
+	}
+
+	void GaussianFactorDynamics::covariance( Time s, Time t, Matrix& result ) const
+	{
+		Size n = dimension();
+
+		if ( result.rows() != n || result.columns() != n )
+			result = Matrix( n, n );
+
+		for ( Size i = 0; i < n; i++ )
+		{
+			for ( Size j = 0; j <= i; j++ )
+			{
+				result[i][j] = result[j][i] = variance( i, j, s, t );
+			}
+		}
+	}
+
+	void GaussianFactorDynamics::covarianceCholesky( Time s, Time t, Matrix& result ) const
+	{
+		Matrix cov;
+		covariance( s, t, cov );
+
+		// flexible, since the covariance is only semi-definite for perfectly correlated factors
+		result = CholeskyDecomposition( cov, true );
+	}
+
+	void GaussianFactorDynamics::resizeMoments( Moments& moments ) const
+	{
+		Size n = dimension();
+
+		if ( moments.variance.rows() != n || moments.variance.columns() != n )
+		{
+			moments.variance = Matrix( n, n );
+			moments.integralVariance = Matrix( n, n );
+			moments.meanTforward = Matrix( n, n );
+		}
+
+		if ( moments.mean.size() != n )
+			moments.mean = Array( n );
+	}
+
+	void GaussianFactorDynamics::sumMeanTforward( Moments& moments ) const
+	{
+		for ( Size i = 0; i < dimension(); i++ )
+		{
+			Real sum = 0;
+			for ( Size j = 0; j < dimension(); j++ )
+			{
+				sum += moments.meanTforward[i][j];
+			}
+
+			moments.mean[i] = -sum;
+		}
 	}
 
 	Real GaussianFactorDynamics::phi( Size i, Size j, Time t ) const
 	{
-		const Parameter& a_i = a_[i];
-		const Parameter& a_j = a_[j];
+		if ( const CumulativeIntegralTable* table = cumulativeIntegrals() )
+			return table->phi( i, j, t );
+
+		const ParameterSnapshot& a_i = aSnapshot_[i];
+		const ParameterSnapshot& a_j = aSnapshot_[j];
 
-		const Parameter& sigma_i = sigma_[i];
-		const Parameter& sigma_j = sigma_[j];
+		const ParameterSnapshot& sigma_i = sigmaSnapshot_[i];
+		const ParameterSnapshot& sigma_j = sigmaSnapshot_[j];
+		const ParameterSnapshot& rho_ij = rhoSnapshot( i, j );
 
 		auto integrand = [&, t]( Time u )
 		{
-			return sigma_i( u ) * sigma_j( u )
-				* (B( j, u, t ) / E( i, u, t ) + B( i, u, t ) / E( j, u, t ));
+			return rho_ij( u ) * sigma_i( u ) * sigma_j( u )
+				* (evaluateB( j, u, t ) / evaluateE( i, u, t ) + evaluateB( i, u, t ) / evaluateE( j, u, t ));
 		};
 
-		return integrator_( integrand, 0, t );
+		return integral( integrand, 0, t );
 	}
 }
\ No newline at end of file
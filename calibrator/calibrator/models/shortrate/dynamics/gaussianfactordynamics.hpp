@@ -1,7 +1,10 @@
 #ifndef CALIBRATOR_MODELS_PARAMETERS_SHORTRATE_GAUSSIANFACTORFITTINGPARAMETER_HPP
 #define CALIBRATOR_MODELS_PARAMETERS_SHORTRATE_GAUSSIANFACTORFITTINGPARAMETER_HPP
 
+#include <initializer_list>
+
 #include <ql/math/matrix.hpp>
+#include <ql/math/matrixutilities/choleskydecomposition.hpp>
 #include <ql/math/integrals/kronrodintegral.hpp>
 #include <ql/math/integrals/simpsonintegral.hpp>
 #include <ql/math/randomnumbers/sobolrsg.hpp>
@@ -9,6 +12,9 @@
 #include <ql/models/parameter.hpp>
 
 #include <calibrator/global.hpp>
+#include <calibrator/models/parameters/integrableconstantparameter.hpp>
+#include <calibrator/models/parameters/parametersnapshot.hpp>
+#include <calibrator/models/shortrate/dynamics/cumulativeintegraltable.hpp>
 
 namespace HJCALIBRATOR
 {
@@ -22,65 +28,237 @@ namespace HJCALIBRATOR
 	using RefParamVector = std::vector<RefParam>;
 	using RefParamMatrix = std::vector<std::vector<RefParam>>;
 
+	/*! What the parameter accessors of the dynamics and of the models return. Defining
+		CALIBRATOR_BY_VALUE_ACCESSORS brings back the copies they used to return, the
+		baseline of "testbed bench". */
+#if defined( CALIBRATOR_BY_VALUE_ACCESSORS )
+	using ParameterAccess = Parameter;
+#else
+	using ParameterAccess = const Parameter&;
+#endif
+
 	class GaussianFactorDynamics
 	{
 	public:
+		//! Every pairwise moment of the factors over (s,t), with the means under the T-forward measure
+		struct Moments
+		{
+			Matrix variance;			// variance( i, j, s, t )
+			Matrix integralVariance;	// integralVariance( i, j, s, t )
+			Matrix meanTforward;		// meanTforward( i, j, T, s, t )
+			Array mean;					// meanTforward( i, T, s, t )
+		};
+
 		GaussianFactorDynamics( const Handle<YieldTermStructure>& termStructure,
 								const ParamVector& a,
 								const ParamVector& sigma,
-								const Matrix& rho = Matrix() );
+								const Matrix& rho = Matrix(),
+								const shared_ptr<Integrator>& integrator = shared_ptr<Integrator>() );
 
 		virtual ~GaussianFactorDynamics() {}
 
 	protected:
 		GaussianFactorDynamics() // for virtual inheritance
-			: integrator_( GaussKronrodAdaptive( 0.01, 10000 ) )
+			: integrator_( defaultIntegrator() )
+			, frozen_( false )
+			, cacheEnabled_( false ), cacheCapacity_( 0 ), version_( 0 ), cacheVersion_( 0 )
+			, cumulativeEnabled_( false ), cumulativeHorizon_( 0 ), cumulativeSteps_( 0 ), cumulativeVersion_( 0 )
 		{}
 
 	public:
 		Size dimension() const { return a_.size(); }
 
-		Parameter a( Size i ) const { return a_[i]; }
-		Parameter sigma( Size i ) const { return sigma_[i]; }
-		Parameter rho( Size i, Size j ) const;
+		ParameterAccess a( Size i ) const { return a_[i]; }
+		ParameterAccess sigma( Size i ) const { return sigma_[i]; }
+		ParameterAccess rho( Size i, Size j ) const;
+
+		Real a( Size i, Time t ) const { return aSnapshot_[i]( t ); }
+		Real sigma( Size i, Time t ) const { return sigmaSnapshot_[i]( t ); }
+		Real rho( Size i, Size j, Time t ) const { return rhoSnapshot_[correlationIndex( i, j )]( t ); }
+
+		//! Flat copies of the parameters, retaken whenever a parameter is set
+		const ParameterSnapshot& aSnapshot( Size i ) const { return aSnapshot_[i]; }
+		const ParameterSnapshot& sigmaSnapshot( Size i ) const { return sigmaSnapshot_[i]; }
+		const ParameterSnapshot& rhoSnapshot( Size i, Size j ) const { return rhoSnapshot_[correlationIndex( i, j )]; }
 
-		Real a( Size i, Time t ) const { return (a_[i])( t ); }
-		Real sigma( Size i, Time t ) const { return (sigma_[i])( t ); }
+		//! Correlation values at time 0, refreshed whenever a correlation is set
+		const Matrix& correlationMatrix() const { return correlation_; }
 
-		void a( const Parameter& a, Size i );
-		void sigma( const Parameter& sigma, Size i );
-		void rho( const Parameter& rho, Size i, Size j );
+		//! Setters, overridden by the families which restrict the parameters or keep nodes of them
+		virtual void a( const Parameter& a, Size i );
+		virtual void sigma( const Parameter& sigma, Size i );
+		virtual void rho( const Parameter& rho, Size i, Size j );
 
 		Handle<YieldTermStructure> termStructure() const { return termStructure_; }
 
+		//! Quadrature used by the integrals without closed form
+		/*! e.g. GaussLegendreIntegral for a fixed cost, GridSimpsonIntegral on the parameter
+		nodes, or GaussKronrodAdaptive with a given tolerance, which is the default.
+		*/
+		const shared_ptr<Integrator>& integrator() const { return integrator_; }
+		void integrator( const shared_ptr<Integrator>& integrator );
+
 		virtual Real E( Size i, Time s, Time t ) const;
 		virtual Real E( Size i, Size j, Time s, Time t ) const;
 		virtual Real B( Size i, Time s, Time t ) const;
 		virtual Real B( Size i, Size j, Time s, Time t ) const;
 		Real meanTforward( Size i, Time T, Time s, Time t ) const;
 
+		// the pairwise integrals below include the instantaneous correlation rho_ij(u) in their integrands
 		virtual Real meanTforward( Size i, Size j, Time T, Time s, Time t ) const;
 		virtual Real integralVariance( Size i, Size j, Time s, Time t ) const;
 		virtual Real variance( Size i, Size j, Time s, Time t ) const;
 
 		virtual Real A( Time t, Time T ) const;
+
+		//! Batch evaluations over a strip of end times, result[k] being the value at T[k]
+		virtual void E( Size i, Time t, const TimeVector& T, RealVector& result ) const;
+		virtual void B( Size i, Time t, const TimeVector& T, RealVector& result ) const;
+		virtual void variance( Size i, Size j, Time s, const TimeVector& t, RealVector& result ) const;
+		virtual void A( Time t, const TimeVector& T, RealVector& result ) const;
+
+		//! All the pairwise moments for (s,t,T) at once
+		/*! The default evaluates each symmetric integral once per pair. The families with
+		closed forms override it to share the exponentials and the segment walk across the pairs.
+		*/
+		virtual void moments( Time s, Time t, Time T, Moments& result ) const;
+
+		//! Covariance matrix of the factors over (s,t), the correlations included
+		virtual void covariance( Time s, Time t, Matrix& result ) const;
+		//! Lower triangular factor L of the covariance above, with \f$ LL^T = \Sigma \f$
+		void covarianceCholesky( Time s, Time t, Matrix& result ) const;
 		
 		virtual Real phi( Time t ) const;
 		virtual Real variance( Time s, Time t ) const;
 		virtual Real integralVariance( Time s, Time t ) const;
 
+		//! Memoization of E(i,s,t), B(i,s,t) and of the variance moments entering A(t,T)
+		/*! When enabled, the values of E and B are stored per factor on the time points
+		which actually get queried, the abscissas of the quadratures excluded, and the
+		moments of A(t,T) are stored per start time t. Everything is dropped whenever a
+		parameter setter is called, and a table holding capacity values is restarted
+		before the next insertion, so that the memory stays bounded within a parameter version.
+		*/
+		void enableCache( bool enable = true, Size capacity = 10000 );
+		bool cacheEnabled() const { return cacheEnabled_; }
+
+		//! Evaluation by tabulated cumulative integrals
+		/*! When enabled, E, B and the pairwise variance, integrated variance, T-forward mean
+		and phi integrals are answered from a CumulativeIntegralTable built once per parameter
+		update on a uniform grid of the given number of steps over [0, horizon],
+		instead of the nested adaptive quadrature.
+		*/
+		void enableCumulativeIntegrals( bool enable = true, Time horizon = 60.0, Size steps = 6000 );
+		bool cumulativeIntegralsEnabled() const { return cumulativeEnabled_; }
+
+		//! Incremented every time one of the parameters is replaced by a setter.
+		Size version() const { return version_; }
+
+		//! Immutable copy, from which several threads can price while this dynamics is recalibrated
+		/*! The tables otherwise built on the first query are built beforehand, the memoization,
+		which inserts on every new query, is disabled, and the setters of the copy throw.
+		The integrator is copied as well, and each call of the copy integrates on a copy of its own,
+		so the integrator has to be one of the rules copyIntegrator knows.
+		*/
+		shared_ptr<const GaussianFactorDynamics> freeze() const;
+		bool frozen() const { return frozen_; }
+
 	protected:
+		//! Copy of the most derived dynamics, overridden by every instantiable class
+		virtual GaussianFactorDynamics* clone() const { return new GaussianFactorDynamics( *this ); }
+
+		//! Builds every table evaluated lazily, so that the queries do not write anymore
+		virtual void precompute() const;
+
+		void checkNotFrozen() const
+		{
+			QL_REQUIRE( !frozen_, "A frozen dynamics cannot be modified." );
+		}
+
 		virtual Real phi( Size i, Size j, Time t ) const;
 
-		GaussKronrodAdaptive integrator_;
+		//! E and B without memoization, overridden along with E and B by the families knowing them in closed form
+		virtual Real evaluateE( Size i, Time s, Time t ) const;
+		virtual Real evaluateB( Size i, Time s, Time t ) const;
+
+		void parametersChanged() { ++version_; }
+
+		//! Throws unless the parameter takes a single value at all times
+		static void requireConstant( const Parameter& parameter );
+		//! Throws unless the parameter is constant or piecewise constant
+		static void requirePiecewiseConstant( const Parameter& parameter );
+		//! Sorted times of the snapshots without duplicates, between which all of them are smooth
+		static void mergeTimes( std::initializer_list<const ParameterSnapshot*> snapshots, RealVector& nodes );
+
+		//! Sizes the moments to the dimension, the storage being kept when it already fits
+		void resizeMoments( Moments& moments ) const;
+		//! mean[i] = -sum_j meanTforward[i][j]
+		void sumMeanTforward( Moments& moments ) const;
+
+		//! Integral of f over (s,t) by the integrator, on a copy of it made for the call once frozen
+		Real integral( const boost::function<Real( Real )>& f, Time s, Time t ) const;
+
+		//! Up-to-date cumulative integral table, or null if the evaluation mode is not enabled
+		const CumulativeIntegralTable* cumulativeIntegrals() const;
+
+		shared_ptr<Integrator> integrator_;
 
 	private:
+		static shared_ptr<Integrator> defaultIntegrator();
+
 		void setupCorrelMatrix( const Matrix& rho );
+		void updateCorrelationMatrix( Size i, Size j );
+
+		// packed upper triangular index, (i,j) with i <= j is stored at j(j+1)/2 + i
+		static Size correlationIndex( Size i, Size j )
+		{
+			return i <= j ? j * (j + 1) / 2 + i : i * (i + 1) / 2 + j;
+		}
+		void checkCacheVersion() const;
+
+		//! Pairwise moments at t of the factors started at 0, packed as the correlations
+		/*! \f$ v_{ij} = Var(x_i(t), x_j(t)) \f$ and \f$ M_{ij} = \int_0^t \rho_{ij}\sigma_i\sigma_j B_j(u,t)/E_i(u,t)du \f$,
+		with which \f$ V(0,T) - V(t,T) - V(0,t) = \sum_{ij} B_iB_j(t,T)v_{ij} + B_i(t,T)M_{ij} + B_j(t,T)M_{ji} \f$.
+		*/
+		struct AffineMoments
+		{
+			RealVector v;
+			RealVector Mij;
+			RealVector Mji;
+		};
+
+		//! Cached moments if the cache is enabled, otherwise the moments evaluated into buffer
+		const AffineMoments& affineMoments( Time t, AffineMoments& buffer ) const;
+		void evaluateAffineMoments( Time t, AffineMoments& moments ) const;
+		Real affineExponent( const AffineMoments& moments, const RealVector& B ) const;
+
+		bool frozen_;
+
+		typedef std::map<std::pair<Time, Time>, Real> TimePairCache;
+
+		bool cacheEnabled_;
+		Size cacheCapacity_;
+		Size version_;
+		mutable Size cacheVersion_;
+		mutable std::vector<TimePairCache> cacheE_;
+		mutable std::vector<TimePairCache> cacheB_;
+		mutable std::map<Time, AffineMoments> cacheA_;
+
+		bool cumulativeEnabled_;
+		Time cumulativeHorizon_;
+		Size cumulativeSteps_;
+		mutable Size cumulativeVersion_;
+		mutable shared_ptr<CumulativeIntegralTable> cumulative_;
 
 		Handle<YieldTermStructure> termStructure_;
 		ParamVector a_;
 		ParamVector sigma_;
-		std::map<std::pair<Size, Size>, Parameter> rho_;
+		ParamVector rho_;
+		Matrix correlation_;
+
+		std::vector<ParameterSnapshot> aSnapshot_;
+		std::vector<ParameterSnapshot> sigmaSnapshot_;
+		std::vector<ParameterSnapshot> rhoSnapshot_;
 	};
 
 	
@@ -95,8 +273,15 @@ namespace HJCALIBRATOR
 
 		virtual ~Gaussian1FactorDynamics() {}
 
+		shared_ptr<const Gaussian1FactorDynamics> freeze() const
+		{
+			return boost::dynamic_pointer_cast<const Gaussian1FactorDynamics>( GaussianFactorDynamics::freeze() );
+		}
+
 	protected:
 		Gaussian1FactorDynamics() {} // for virtual inheritance
+
+		virtual GaussianFactorDynamics* clone() const override { return new Gaussian1FactorDynamics( *this ); }
 	};
 
 	class Gaussian2FactorDynamics : public virtual GaussianFactorDynamics
@@ -113,8 +298,15 @@ namespace HJCALIBRATOR
 
 		virtual ~Gaussian2FactorDynamics() {}
 
+		shared_ptr<const Gaussian2FactorDynamics> freeze() const
+		{
+			return boost::dynamic_pointer_cast<const Gaussian2FactorDynamics>( GaussianFactorDynamics::freeze() );
+		}
+
 	protected:
 		Gaussian2FactorDynamics() {} // for virtual inheritance
+
+		virtual GaussianFactorDynamics* clone() const override { return new Gaussian2FactorDynamics( *this ); }
 		
 		Matrix getCorrelationMatrix( Real rho )
 		{
@@ -0,0 +1,38 @@
+#include <algorithm>
+
+#include <calibrator/models/shortrate/dynamics/phicurve.hpp>
+#include <calibrator/models/shortrate/dynamics/gaussianfactordynamics.hpp>
+
+namespace HJCALIBRATOR
+{
+	PhiCurve::PhiCurve( const GaussianFactorDynamics& dynamics, const TimeGrid& grid )
+		: times_( grid.begin(), grid.end() )
+	{
+		QL_REQUIRE( !times_.empty(), "Empty time grid given for the phi curve." );
+
+		values_.reserve( times_.size() );
+		for ( Time t : times_ )
+		{
+			values_.push_back( dynamics.phi( t ) );
+		}
+	}
+
+	Real PhiCurve::operator()( Time t ) const
+	{
+		if ( t <= times_.front() )
+			return values_.front();
+
+		if ( t >= times_.back() )
+			return values_.back();
+
+		Size k = std::upper_bound( times_.begin(), times_.end(), t ) - times_.begin();
+
+		Time t0 = times_[k - 1];
+		Time t1 = times_[k];
+
+		if ( t == t0 )
+			return values_[k - 1];
+
+		return values_[k - 1] + (values_[k] - values_[k - 1]) * (t - t0) / (t1 - t0);
+	}
+}
@@ -0,0 +1,35 @@
+#ifndef CALIBRATOR_MODELS_SHORTRATE_DYNAMICS_PHICURVE_HPP
+#define CALIBRATOR_MODELS_SHORTRATE_DYNAMICS_PHICURVE_HPP
+
+#include <vector>
+
+#include <ql/timegrid.hpp>
+
+#include <calibrator/global.hpp>
+
+namespace HJCALIBRATOR
+{
+	class GaussianFactorDynamics;
+
+	//! Deterministic shift \f$ \varphi(t) \f$ of a gaussian factor dynamics tabulated on a time grid
+	/*! The values are exact at the grid points, linearly interpolated in between and
+	extrapolated flat outside of the grid. The curve is a snapshot of the parameters at
+	construction, so it has to be rebuilt after a calibration.
+	*/
+	class PhiCurve
+	{
+	public:
+		PhiCurve( const GaussianFactorDynamics& dynamics, const TimeGrid& grid );
+
+		Real operator()( Time t ) const;
+
+		const std::vector<Time>& times() const { return times_; }
+		const std::vector<Real>& values() const { return values_; }
+
+	private:
+		std::vector<Time> times_;
+		std::vector<Real> values_;
+	};
+}
+
+#endif // !CALIBRATOR_MODELS_SHORTRATE_DYNAMICS_PHICURVE_HPP
@@ -0,0 +1,233 @@
+#ifndef CALIBRATOR_MODELS_SHORTRATE_DYNAMICS_PIECEWISECONSTANTINTEGRALS_HPP
+#define CALIBRATOR_MODELS_SHORTRATE_DYNAMICS_PIECEWISECONSTANTINTEGRALS_HPP
+
+#include <algorithm>
+#include <vector>
+
+#include <ql/types.hpp>
+#include <ql/errors.hpp>
+
+#include <calibrator/global.hpp>
+#include <calibrator/models/shortrate/dynamics/gaussianfactordynamics.hpp>
+#include <calibrator/models/shortrate/dynamics/gaussianfactor/g++constant.hpp>
+#include <calibrator/models/shortrate/dynamics/segmentintegrals.hpp>
+
+namespace HJCALIBRATOR
+{
+	//! Gaussian factor integrals with constant mean reversions and piecewise constant volatilities, on a generic scalar
+	/*! This is the closed form evaluation of GPPConstantDynamics and GPPPCMRPCV written on plain values
+	of the scalar type T instead of Parameter, so that it also runs with an operator overloading
+	automatic differentiation type. One adjoint sweep over a price computed from these integrals,
+	e.g. by g2Swaption, then returns the sensitivities to every mean reversion, volatility and
+	correlation value at once.
+
+	All the factors share the node set : sigma[i][k] and rho[p][k] apply before nodes[k], and the last
+	value after the last node, as in PiecewiseConstantParameter. The correlations are packed as in
+	GaussianFactorDynamics, the pair (i,j) with i <= j being at j(j+1)/2 + i. Without any node, these
+	are the integrals of GPPConstantDynamics.
+	*/
+	template <class T>
+	class PiecewiseConstantIntegrals
+	{
+	public:
+		PiecewiseConstantIntegrals( const std::vector<T>& a,
+									const std::vector<Time>& nodes,
+									const std::vector<std::vector<T>>& sigma,
+									const std::vector<std::vector<T>>& rho );
+
+		//! Integrals of dynamics with constant mean reversions, e.g. GPPConstantDynamics or GPPPCMRPCV
+		/*! The volatilities and correlations have to be constant or piecewise constant, and their nodes
+		are merged into the shared node set. GPPConstantDynamics takes them at time 0 whatever their
+		type, and so does this constructor. Their current values are taken as plain values of T.
+		*/
+		explicit PiecewiseConstantIntegrals( const GaussianFactorDynamics& dynamics );
+
+		Size dimension() const { return a_.size(); }
+
+		//! Values the integrals are taken on, e.g. to build them again on another scalar type
+		const std::vector<T>& a() const { return a_; }
+		const std::vector<Time>& nodes() const { return nodes_; }
+		const std::vector<std::vector<T>>& sigma() const { return sigma_; }
+		const std::vector<std::vector<T>>& rho() const { return rho_; }
+
+		T B( Size i, Time s, Time t ) const { return segmentB( a_[i], t - s ); }
+
+		//! v, Mij, Mji and J of SegmentPairIntegrals over (s,t), the correlation included
+		BasicSegmentPairIntegrals<T> pairIntegrals( Size i, Size j, Time s, Time t ) const;
+
+		T variance( Size i, Size j, Time s, Time t ) const { return pairIntegrals( i, j, s, t ).v; }
+		T integralVariance( Size i, Size j, Time s, Time t ) const { return pairIntegrals( i, j, s, t ).J; }
+		T meanTforward( Size i, Size j, Time maturity, Time s, Time t ) const;
+		T meanTforward( Size i, Time maturity, Time s, Time t ) const;
+
+		//! \f$ \ln( A(t,T)P(0,t)/P(0,T) ) \f$
+		T logA( Time t, Time maturity ) const;
+
+	private:
+		static Size correlationIndex( Size i, Size j )
+		{
+			return i <= j ? j * (j + 1) / 2 + i : i * (i + 1) / 2 + j;
+		}
+
+		std::vector<T> a_;
+		std::vector<Time> nodes_;
+		std::vector<std::vector<T>> sigma_;
+		std::vector<std::vector<T>> rho_;
+	};
+
+	// template definitions
+
+	template <class T>
+	PiecewiseConstantIntegrals<T>::PiecewiseConstantIntegrals( const std::vector<T>& a,
+															   const std::vector<Time>& nodes,
+															   const std::vector<std::vector<T>>& sigma,
+															   const std::vector<std::vector<T>>& rho )
+		: a_( a ), nodes_( nodes ), sigma_( sigma ), rho_( rho )
+	{
+		Size n = a_.size();
+
+		QL_REQUIRE( sigma_.size() == n, "One volatility is required per factor." );
+		QL_REQUIRE( rho_.size() == n * (n + 1) / 2, "One correlation is required per pair of factors." );
+		QL_REQUIRE( std::is_sorted( nodes_.begin(), nodes_.end() ), "The nodes must be sorted." );
+
+		for ( Size i = 0; i < n; i++ )
+		{
+			QL_REQUIRE( sigma_[i].size() == nodes_.size() + 1,
+						"Requirement not met for " << i << "-th sigma : node size + 1 == value size" );
+		}
+
+		for ( Size p = 0; p < rho_.size(); p++ )
+		{
+			QL_REQUIRE( rho_[p].size() == nodes_.size() + 1,
+						"Requirement not met for " << p << "-th correlation : node size + 1 == value size" );
+		}
+	}
+
+	template <class T>
+	PiecewiseConstantIntegrals<T>::PiecewiseConstantIntegrals( const GaussianFactorDynamics& dynamics )
+	{
+		Size n = dynamics.dimension();
+
+		std::vector<const ParameterSnapshot*> snapshots;
+		for ( Size i = 0; i < n; i++ )
+		{
+			QL_REQUIRE( dynamics.aSnapshot( i ).kind() == ParameterSnapshot::Constant,
+						"The " << i << "-th mean reversion is not constant." );
+
+			snapshots.push_back( &dynamics.sigmaSnapshot( i ) );
+		}
+
+		for ( Size j = 0; j < n; j++ )
+		{
+			for ( Size i = 0; i <= j; i++ )
+			{
+				snapshots.push_back( &dynamics.rhoSnapshot( i, j ) );
+			}
+		}
+
+		if ( !dynamic_cast<const GPPConstantDynamics*>( &dynamics ) )
+		{
+			for ( const ParameterSnapshot* snapshot : snapshots )
+			{
+				QL_REQUIRE( snapshot->kind() == ParameterSnapshot::Constant || snapshot->kind() == ParameterSnapshot::PiecewiseConstant,
+							"The volatilities and correlations have to be piecewise constant." );
+
+				nodes_.insert( nodes_.end(), snapshot->times().begin(), snapshot->times().end() );
+			}
+		}
+
+		std::sort( nodes_.begin(), nodes_.end() );
+		nodes_.erase( std::unique( nodes_.begin(), nodes_.end() ), nodes_.end() );
+
+		a_.resize( n );
+		sigma_.assign( n, std::vector<T>( nodes_.size() + 1 ) );
+		rho_.assign( n * (n + 1) / 2, std::vector<T>( nodes_.size() + 1 ) );
+
+		for ( Size i = 0; i < n; i++ )
+		{
+			a_[i] = dynamics.a( i, 0.0 );
+		}
+
+		for ( Size k = 0; k <= nodes_.size(); k++ )
+		{
+			// any time of the segment before nodes[k], e.g. its start, where the earlier nodes are passed
+			Time u = k > 0 ? nodes_[k - 1] : nodes_.empty() ? 0.0 : nodes_[0] - 1.0;
+
+			for ( Size j = 0; j < n; j++ )
+			{
+				sigma_[j][k] = dynamics.sigma( j, u );
+
+				for ( Size i = 0; i <= j; i++ )
+				{
+					rho_[correlationIndex( i, j )][k] = dynamics.rho( i, j, u );
+				}
+			}
+		}
+	}
+
+	template <class T>
+	BasicSegmentPairIntegrals<T> PiecewiseConstantIntegrals<T>::pairIntegrals( Size i, Size j, Time s, Time t ) const
+	{
+		const std::vector<T>& rho = rho_[correlationIndex( i, j )];
+
+		BasicSegmentPairIntegrals<T> integrals;
+
+		Size k = std::upper_bound( nodes_.begin(), nodes_.end(), s ) - nodes_.begin();
+
+		Time begin = s;
+		while ( begin < t )
+		{
+			Time end = k < nodes_.size() ? std::min( nodes_[k], t ) : t;
+
+			integrals.advance( a_[i], a_[j], rho[k] * sigma_[i][k] * sigma_[j][k], end - begin );
+
+			begin = end;
+			k++;
+		}
+
+		return integrals;
+	}
+
+	template <class T>
+	T PiecewiseConstantIntegrals<T>::meanTforward( Size i, Size j, Time maturity, Time s, Time t ) const
+	{
+		BasicSegmentPairIntegrals<T> integrals = pairIntegrals( i, j, s, t );
+
+		return B( j, t, maturity ) * integrals.v + integrals.Mij;
+	}
+
+	template <class T>
+	T PiecewiseConstantIntegrals<T>::meanTforward( Size i, Time maturity, Time s, Time t ) const
+	{
+		T sum = 0;
+		for ( Size j = 0; j < dimension(); j++ )
+		{
+			sum += meanTforward( i, j, maturity, s, t );
+		}
+
+		return -sum;
+	}
+
+	template <class T>
+	T PiecewiseConstantIntegrals<T>::logA( Time t, Time maturity ) const
+	{
+		// V(0,T) - V(t,T) - V(0,t) from the pairwise moments at t, as in GaussianFactorDynamics::A
+		T exponent = 0;
+		for ( Size i = 0; i < dimension(); i++ )
+		{
+			T Bi = B( i, t, maturity );
+
+			for ( Size j = 0; j < dimension(); j++ )
+			{
+				T Bj = B( j, t, maturity );
+				BasicSegmentPairIntegrals<T> integrals = pairIntegrals( i, j, 0, t );
+
+				exponent += Bi * Bj * integrals.v + Bi * integrals.Mij + Bj * integrals.Mji;
+			}
+		}
+
+		return -0.5 * exponent;
+	}
+}
+
+#endif // !CALIBRATOR_MODELS_SHORTRATE_DYNAMICS_PIECEWISECONSTANTINTEGRALS_HPP
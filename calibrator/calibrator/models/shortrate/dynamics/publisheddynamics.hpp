@@ -0,0 +1,48 @@
+#ifndef CALIBRATOR_MODELS_SHORTRATE_DYNAMICS_PUBLISHEDDYNAMICS_HPP
+#define CALIBRATOR_MODELS_SHORTRATE_DYNAMICS_PUBLISHEDDYNAMICS_HPP
+
+#include <boost/shared_ptr.hpp>
+#include <boost/pointer_cast.hpp>
+
+#include <calibrator/global.hpp>
+#include <calibrator/models/shortrate/dynamics/gaussianfactordynamics.hpp>
+
+namespace HJCALIBRATOR
+{
+	//! Latest frozen dynamics, swapped atomically between a calibrating thread and pricing threads
+	/*! The writer freezes the dynamics outside of any synchronization, and then replaces the
+	published pointer. A reader takes a reference to the current snapshot, which stays valid and
+	unchanged for as long as the reader holds it, even if newer snapshots are published meanwhile.
+	No mutex is involved : the pointer is loaded and stored by the atomic accesses of boost::shared_ptr,
+	which only spin for the duration of the reference count update.
+	*/
+	template <class FactorDynamics>
+	class PublishedDynamics
+	{
+	public:
+		//! Freezes the dynamics and publishes the copy
+		void publish( const FactorDynamics& dynamics )
+		{
+			publish( boost::dynamic_pointer_cast<const FactorDynamics>( dynamics.GaussianFactorDynamics::freeze() ) );
+		}
+
+		//! Publishes an already frozen dynamics
+		void publish( const shared_ptr<const FactorDynamics>& frozen )
+		{
+			QL_REQUIRE( !frozen || frozen->frozen(), "Only a frozen dynamics can be published." );
+
+			boost::atomic_store( &current_, frozen );
+		}
+
+		//! Snapshot published last, null before the first publication
+		shared_ptr<const FactorDynamics> current() const
+		{
+			return boost::atomic_load( &current_ );
+		}
+
+	private:
+		shared_ptr<const FactorDynamics> current_;
+	};
+}
+
+#endif // !CALIBRATOR_MODELS_SHORTRATE_DYNAMICS_PUBLISHEDDYNAMICS_HPP
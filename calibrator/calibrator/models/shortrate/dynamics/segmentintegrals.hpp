@@ -0,0 +1,315 @@
+#ifndef CALIBRATOR_MODELS_SHORTRATE_DYNAMICS_SEGMENTINTEGRALS_HPP
+#define CALIBRATOR_MODELS_SHORTRATE_DYNAMICS_SEGMENTINTEGRALS_HPP
+
+#include <cmath>
+#include <utility>
+
+#include <ql/types.hpp>
+
+#include <calibrator/global.hpp>
+
+namespace HJCALIBRATOR
+{
+	/* The closed forms below are templated on the scalar type, so that they also run with an
+	automatic differentiation type providing exp, expm1 and fabs, see PiecewiseConstantIntegrals. */
+
+	//! Exponential moments \f$ m_n = \int_0^{dt} y^n e^{-\kappa y}dy \f$ for n = 0, 1, 2
+	template <class T>
+	inline void exponentialMoments( const T& kappa, Time dt, T m[3] )
+	{
+		using std::exp;
+		using std::fabs;
+
+		T x = kappa * dt;
+
+		if ( fabs( x ) < 0.1 )
+		{
+			// series expansion, the upward recursion below loses digits for small x
+			T term = 1;
+			m[0] = m[1] = m[2] = 0;
+			for ( Size k = 0; k < 12; k++ )
+			{
+				m[0] += term / (k + 1);
+				m[1] += term / (k + 2);
+				m[2] += term / (k + 3);
+				term *= -x / (k + 1);
+			}
+			m[0] *= dt;
+			m[1] *= dt * dt;
+			m[2] *= dt * dt * dt;
+			return;
+		}
+
+		T e = exp( -x );
+		m[0] = (1 - e) / kappa;
+		m[1] = (m[0] - dt * e) / kappa;
+		m[2] = (2 * m[1] - dt * dt * e) / kappa;
+	}
+
+	//! \f$ B(0,dt) = (1-e^{-a\,dt})/a \f$ for a constant mean reversion a
+	template <class T>
+	inline T segmentB( const T& a, Time dt )
+	{
+		using std::expm1;
+		using std::fabs;
+
+		T x = a * dt;
+		return fabs( x ) < 1e-8 ? T( dt * (1 - x / 2) ) : T( -expm1( -x ) / a );
+	}
+
+	//! Normalised moments \f$ \mu_p = \int_0^1 s^pe^{-xs}ds \f$ for p < n
+	/*! The recursion \f$ x\mu_{p+1} = (p+1)\mu_p - e^{-x} \f$ is run upward while \f$ p < |x| \f$,
+	and downward from a series for \f$ \mu_{n-1} \f$ above, so that it never amplifies the error.
+	*/
+	template <class T>
+	inline void normalisedExponentialMoments( const T& x, Size n, T* mu )
+	{
+		using std::exp;
+		using std::expm1;
+		using std::fabs;
+
+		T e = exp( -x );
+
+		Size up = 0;
+		if ( !(fabs( x ) < 1.0) )
+		{
+			mu[0] = -expm1( -x ) / x;
+			for ( up = 1; up < n && !(fabs( x ) < Real( up )); up++ )
+				mu[up] = (up * mu[up - 1] - e) / x;
+		}
+
+		if ( up == n )
+			return;
+
+		// |x| < n here, both series have positive terms
+		const Size top = n - 1;
+		T sum = 0;
+		if ( x > 0.0 )
+		{
+			T term = T( 1 ) / (top + 1);
+			for ( Size k = 1; k < 200 && term > 1e-17 * sum; k++ )
+			{
+				sum += term;
+				term *= x / (top + 1 + k);
+			}
+			sum *= e;
+		}
+		else
+		{
+			T term = 1;
+			for ( Size k = 0; k < 200 && term > 1e-17 * sum * (top + 1 + k); k++ )
+			{
+				sum += term / (top + 1 + k);
+				term *= -x / (k + 1);
+			}
+		}
+
+		mu[top] = sum;
+		for ( Size p = top; p-- > up; )
+			mu[p] = (x * mu[p + 1] + e) / (p + 1);
+	}
+
+	//! localSegmentIntegrals when \f$ a_sdt \f$ is small and \f$ a_ldt \f$ is not
+	/*! \f$ L_{a_s} \f$ is expanded in powers of \f$ a_s \f$, which leaves moments of \f$ e^{-a_ly} \f$
+	only, and the remaining divisions are by \f$ a_l \f$. Returns in order \f$ \int \sigma_i\sigma_je^{-(a_l+a_s)y} \f$,
+	\f$ \int \sigma_i\sigma_je^{-a_ly}L_{a_s} \f$, \f$ \int \sigma_i\sigma_je^{-a_sy}L_{a_l} \f$ and \f$ \int \sigma_i\sigma_jL_{a_l}L_{a_s} \f$.
+	*/
+	template <class T>
+	inline void mixedSegmentIntegrals( const T& al, const T& as, const T& d0, const T& d1, const T& d2, Time dt, T local[4] )
+	{
+		// |as dt| < 0.1, the terms of L_as decrease faster than 0.1^k / (k + 1)!
+		const Size order = 12;
+
+		T mu[order + 3];
+		normalisedExponentialMoments( T( al * dt ), order + 3, mu );
+
+		// the moments int_0^dt y^p e^{-al y} dy, and those of the plain polynomial
+		Real power = dt;
+		for ( Size p = 0; p < order + 3; p++ )
+		{
+			mu[p] *= power;
+			power *= dt;
+		}
+
+		T ml = 0, m0 = 0;
+		T coefficient = 1;
+		power = dt * dt;
+		for ( Size k = 1; k <= order; k++ )
+		{
+			// y^k / k! (-as)^(k-1) is the k-th term of L_as(y)
+			coefficient /= k;
+			ml += coefficient * (d0 * mu[k] + d1 * mu[k + 1] + d2 * mu[k + 2]);
+			m0 += coefficient * (d0 * power / (k + 1) + d1 * power * dt / (k + 2) + d2 * power * dt * dt / (k + 3));
+			coefficient *= -as;
+			power *= dt;
+		}
+
+		T ms[3], mls[3];
+		exponentialMoments( as, dt, ms );
+		exponentialMoments( T( al + as ), dt, mls );
+
+		local[0] = d0 * mls[0] + d1 * mls[1] + d2 * mls[2];
+		local[1] = ml;
+		local[2] = (d0 * (ms[0] - mls[0]) + d1 * (ms[1] - mls[1]) + d2 * (ms[2] - mls[2])) / al;
+		local[3] = (m0 - ml) / al;
+	}
+
+	//! Local contributions of a segment to the pairwise integrals
+	/*! With \f$ \sigma_i\sigma_j = d_0 + d_1y + d_2y^2 \f$, y being the time to the end of the
+	segment of length dt, and \f$ L_a(y) = (1-e^{-ay})/a \f$, returns
+	\f$ \int \sigma_i\sigma_je^{-(a_i+a_j)y} \f$, \f$ \int \sigma_i\sigma_je^{-a_iy}L_{a_j} \f$,
+	\f$ \int \sigma_i\sigma_je^{-a_jy}L_{a_i} \f$ and \f$ \int \sigma_i\sigma_jL_{a_i}L_{a_j} \f$.
+	The closed forms divide by the mean reversions. A Taylor expansion in y is used when both
+	\f$ a_idt \f$ and \f$ a_jdt \f$ are small, and one in the small mean reversion alone when only
+	one of them is, see mixedSegmentIntegrals.
+	*/
+	template <class T>
+	inline void localSegmentIntegrals( const T& ai, const T& aj, const T& d0, const T& d1, const T& d2, Time dt, T local[4] )
+	{
+		using std::fabs;
+
+		bool smallI = fabs( ai * dt ) < 0.1;
+		bool smallJ = fabs( aj * dt ) < 0.1;
+
+		if ( smallI != smallJ )
+		{
+			if ( smallJ )
+			{
+				mixedSegmentIntegrals( ai, aj, d0, d1, d2, dt, local );
+			}
+			else
+			{
+				mixedSegmentIntegrals( aj, ai, d0, d1, d2, dt, local );
+				std::swap( local[1], local[2] );
+			}
+			return;
+		}
+
+		if ( smallI )
+		{
+			const Size order = 14;
+			T ei[order], ej[order], li[order], lj[order];
+
+			ei[0] = ej[0] = 1;
+			li[0] = lj[0] = 0;
+			for ( Size k = 1; k < order; k++ )
+			{
+				ei[k] = -ai * ei[k - 1] / k;
+				ej[k] = -aj * ej[k - 1] / k;
+				li[k] = ei[k - 1] / k;
+				lj[k] = ej[k - 1] / k;
+			}
+
+			// w[k] = int_0^dt y^k dy
+			Real w[order + 2];
+			Real power = dt;
+			for ( Size k = 0; k < order + 2; k++ )
+			{
+				w[k] = power / (k + 1);
+				power *= dt;
+			}
+
+			local[0] = local[1] = local[2] = local[3] = 0;
+
+			for ( Size k = 0; k < order; k++ )
+			{
+				// coefficients of y^k of the products
+				T pv = 0, pmij = 0, pmji = 0, pj = 0;
+				for ( Size p = 0; p <= k; p++ )
+				{
+					pv += ei[p] * ej[k - p];
+					pmij += ei[p] * lj[k - p];
+					pmji += li[p] * ej[k - p];
+					pj += li[p] * lj[k - p];
+				}
+
+				T c = d0 * w[k] + d1 * w[k + 1] + d2 * w[k + 2];
+
+				local[0] += c * pv;
+				local[1] += c * pmij;
+				local[2] += c * pmji;
+				local[3] += c * pj;
+			}
+			return;
+		}
+
+		T mi[3], mj[3], mij[3], m[3];
+		exponentialMoments( ai, dt, mi );
+		exponentialMoments( aj, dt, mj );
+		exponentialMoments( T( ai + aj ), dt, mij );
+		exponentialMoments( T( 0 ), dt, m );
+
+		local[0] = d0 * mij[0] + d1 * mij[1] + d2 * mij[2];
+		local[1] = (d0 * (mi[0] - mij[0]) + d1 * (mi[1] - mij[1]) + d2 * (mi[2] - mij[2])) / aj;
+		local[2] = (d0 * (mj[0] - mij[0]) + d1 * (mj[1] - mij[1]) + d2 * (mj[2] - mij[2])) / ai;
+		local[3] = (d0 * (m[0] - mi[0] - mj[0] + mij[0])
+					 + d1 * (m[1] - mi[1] - mj[1] + mij[1])
+					 + d2 * (m[2] - mi[2] - mj[2] + mij[2])) / ai / aj;
+	}
+
+	//! Pairwise gaussian factor integrals accumulated segment by segment
+	/*! For an interval \f$ [s,t] \f$ the state holds
+	\f[
+	v = \int_s^t \frac{\sigma_i\sigma_j}{E_i(u,t)E_j(u,t)}du, \quad
+	M_{ij} = \int_s^t \sigma_i\sigma_j\frac{B_j(u,t)}{E_i(u,t)}du, \quad
+	J = \int_s^t \sigma_i\sigma_jB_i(u,t)B_j(u,t)du,
+	\f]
+	and advance() extends \f$ t \f$ over a segment on which \f$ a_i, a_j \f$ and
+	\f$ \sigma_i\sigma_j \f$ are constant. The recursion is exact and every quantity stays
+	bounded, since no \f$ E(0,t) \f$ factor is carried.
+	*/
+	template <class T>
+	struct BasicSegmentPairIntegrals
+	{
+		BasicSegmentPairIntegrals()
+			: v( 0 ), Mij( 0 ), Mji( 0 ), J( 0 )
+		{}
+
+		void advance( const T& ai, const T& aj, const T& sigmaij, Time dt )
+		{
+			advance( ai, aj, sigmaij, T( 0 ), T( 0 ), dt );
+		}
+
+		//! Same as above, with \f$ \sigma_i\sigma_j = d_0 + d_1y + d_2y^2 \f$, y being the time to the end of the segment
+		void advance( const T& ai, const T& aj, const T& d0, const T& d1, const T& d2, Time dt )
+		{
+			using std::exp;
+
+			T local[4];
+			localSegmentIntegrals( ai, aj, d0, d1, d2, dt, local );
+
+			T ei = exp( -ai * dt );
+			T ej = exp( -aj * dt );
+			T bi = segmentB( ai, dt );
+			T bj = segmentB( aj, dt );
+
+			J += bj * Mji + bi * Mij + bi * bj * v + local[3];
+			Mij = ei * (Mij + bj * v) + local[1];
+			Mji = ej * (Mji + bi * v) + local[2];
+			v = ei * ej * v + local[0];
+		}
+
+		void swap()
+		{
+			std::swap( Mij, Mji );
+		}
+
+		T v;
+		T Mij;
+		T Mji;
+		T J;
+	};
+
+	typedef BasicSegmentPairIntegrals<Real> SegmentPairIntegrals;
+
+	//! Exact \f$ B(s,t) \f$ recursion : prepends a segment of length dt with constant mean reversion a
+	template <class T>
+	inline T prependSegmentB( const T& a, Time dt, const T& Bnext )
+	{
+		using std::exp;
+
+		return segmentB( a, dt ) + exp( -a * dt ) * Bnext;
+	}
+}
+
+#endif // !CALIBRATOR_MODELS_SHORTRATE_DYNAMICS_SEGMENTINTEGRALS_HPP
@@ -1,14 +1,20 @@
+#include <typeinfo>
+
 #include <ql/pricingengines/blackformula.hpp>
 
 #include <calibrator/models/shortrate/onefactormodels/generalg1.hpp>
+#include <calibrator/models/shortrate/dynamics/gaussianfactor/g++constant.hpp>
+#include <calibrator/models/shortrate/dynamics/gaussianfactor/g++cmr_pcv.hpp>
 
 namespace HJCALIBRATOR
 {
-	GeneralizedG1::GeneralizedG1( shared_ptr<Gaussian1FactorDynamics> dynamics )
+	GeneralizedG1::GeneralizedG1( const shared_ptr<Gaussian1FactorDynamics>& dynamics )
 		: OneFactorAffineModel( 2 )
 		, TermStructureConsistentModel( dynamics->termStructure() )
 		, a_( arguments_[0] ), sigma_( arguments_[1] )
 		, dynamics_( dynamics )
+		, fixedFamily_( typeid(*dynamics) == typeid(G1ConstantDynamics) || typeid(*dynamics) == typeid(G1PPPCMRPCV) )
+		, fixedVersion_( 0 )
 	{
 		QL_ENSURE( dynamics->dimension() == 1,
 				   "The dimension of the dynamics exceeds one" );
@@ -26,8 +32,25 @@ namespace HJCALIBRATOR
 	}
 
 
+	const FixedFactorDynamics<1>* GeneralizedG1::fixedDynamics() const
+	{
+		if ( !fixedFamily_ )
+			return nullptr;
+
+		if ( !fixed_ || fixedVersion_ != dynamics_->version() )
+		{
+			fixed_.reset( new FixedFactorDynamics<1>( *dynamics_ ) );
+			fixedVersion_ = dynamics_->version();
+		}
+
+		return fixed_.get();
+	}
+
 	Real GeneralizedG1::A( Time t, Time T ) const
 	{
+		if ( const FixedFactorDynamics<1>* fixed = fixedDynamics() )
+			return fixed->A( t, T );
+
 		return dynamics_->A( t, T );
 	}
 
@@ -40,6 +63,17 @@ namespace HJCALIBRATOR
 												   Real strike,
 												   Time maturity,
 												   Time bondMaturity ) const
+	{
+		if ( const FixedFactorDynamics<1>* fixed = fixedDynamics() )
+			return evaluateDiscountBondOption( *fixed, type, strike, maturity, bondMaturity );
+
+		return evaluateDiscountBondOption( *dynamics_, type, strike, maturity, bondMaturity );
+	}
+
+	template <class FactorDynamics>
+	Real GeneralizedG1::evaluateDiscountBondOption( const FactorDynamics& dynamics,
+													Option::Type type, Real strike,
+													Time maturity, Time bondMaturity ) const
 	{
 		/*
 		From eq. 10 - 11
@@ -61,8 +95,8 @@ namespace HJCALIBRATOR
 		*/
 
 		/* eq. 8 */
-		Real Vr_t_TF = dynamics_->variance( 0, maturity );
-		Real B_TF_TP = dynamics_->B( 0, maturity, bondMaturity );
+		Real Vr_t_TF = dynamics.variance( 0, maturity );
+		Real B_TF_TP = dynamics.B( 0, maturity, bondMaturity );
 		Real Vp_0_TF_TP = Vr_t_TF * B_TF_TP * B_TF_TP;
 
 		/* eq. 11 */
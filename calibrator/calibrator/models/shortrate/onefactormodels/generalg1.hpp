@@ -5,6 +5,8 @@
 
 #include <calibrator/global.hpp>
 #include <calibrator/models/shortrate/dynamics/gaussianfactordynamics.hpp>
+#include <calibrator/models/shortrate/dynamics/fixedfactordynamics.hpp>
+#include <calibrator/models/shortrate/dynamics/phicurve.hpp>
 #include <calibrator/processes/generalornsteinuhlenbeckprocess.hpp>
 
 namespace HJCALIBRATOR
@@ -16,18 +18,17 @@ namespace HJCALIBRATOR
 		shared_ptr<Gaussian1FactorDynamics> dynamics_;
 		
 	public :
-		GeneralizedG1( shared_ptr<Gaussian1FactorDynamics> dynamics );
+		GeneralizedG1( const shared_ptr<Gaussian1FactorDynamics>& dynamics );
 		virtual ~GeneralizedG1() {}
 
 		// OneFactorModel virtual override
-		shared_ptr<Lattice> tree( const TimeGrid& grid ) const override
-		{
-			// todo
-			return shared_ptr<Lattice>();
-		};
+		shared_ptr<Lattice> tree( const TimeGrid& grid ) const override;
 
 		virtual shared_ptr<ShortRateDynamics> dynamics() const override;
 
+		//! Same as above with phi tabulated on the grid, for lattices and path generation
+		shared_ptr<ShortRateDynamics> dynamics( const TimeGrid& grid ) const;
+
 
 		virtual Real discountBondOption( Option::Type type,
 										 Real strike,
@@ -38,8 +39,8 @@ namespace HJCALIBRATOR
 										 Time maturity, Time bondStart,
 										 Time bondMaturity ) const override;
 
-		Parameter a() const { return a_; }
-		Parameter sigma() const { return sigma_; }
+		ParameterAccess a() const { return a_; }
+		ParameterAccess sigma() const { return sigma_; }
 
 	private :
 		// CalibratedModel virtual override
@@ -49,28 +50,47 @@ namespace HJCALIBRATOR
 		virtual Real A( Time t, Time T ) const override;
 		virtual Real B( Time t, Time T ) const override;
 
+		//! The fixed dimension front end of the dynamics, null unless it is G1ConstantDynamics or G1PPPCMRPCV
+		/*! Built again after a parameter update. */
+		const FixedFactorDynamics<1>* fixedDynamics() const;
+
+		template <class FactorDynamics>
+		Real evaluateDiscountBondOption( const FactorDynamics& dynamics,
+										 Option::Type type, Real strike,
+										 Time maturity, Time bondMaturity ) const;
+
 		Parameter& a_;
 		Parameter& sigma_;
+
+		bool fixedFamily_;
+		mutable shared_ptr<const FixedFactorDynamics<1>> fixed_;
+		mutable Size fixedVersion_;
 	};
 
 	//! Short-rate dynamics in the time-dependent Hull-White model
 	/*! The short-rate follows an time-dependent Hull-White process */
 	class GeneralizedG1::Dynamics : public OneFactorModel::ShortRateDynamics {
 	public:
-		Dynamics( shared_ptr<Gaussian1FactorDynamics> dynamics )
+		Dynamics( const shared_ptr<Gaussian1FactorDynamics>& dynamics,
+				  const shared_ptr<PhiCurve>& phi = shared_ptr<PhiCurve>() )
 			: ShortRateDynamics( shared_ptr<StochasticProcess1D>(
 				new GeneralizedOrnsteinUhlenbeckProcess( dynamics->a( 0 ), dynamics->sigma( 0 ) ) ) )
-			, dynamics_( dynamics )
+			, dynamics_( dynamics ), phi_( phi )
 		{}
 
 		virtual Real variable( Time t, Rate r ) const {
-			return r - dynamics_->phi( t );
+			return r - phi( t );
 		}
 		virtual Real shortRate( Time t, Real x ) const {
-			return x + dynamics_->phi( t );
+			return x + phi( t );
+		}
+
+		Real phi( Time t ) const {
+			return phi_ ? (*phi_)( t ) : dynamics_->phi( t );
 		}
 
 		shared_ptr<Gaussian1FactorDynamics> dynamics_;
+		shared_ptr<PhiCurve> phi_;
 	};
 
 	// inline definitions
@@ -78,6 +98,20 @@ namespace HJCALIBRATOR
 	{
 		return shared_ptr<ShortRateDynamics>( new Dynamics( dynamics_ ) );
 	}
+
+	inline shared_ptr<OneFactorModel::ShortRateDynamics>	GeneralizedG1::dynamics( const TimeGrid& grid ) const
+	{
+		return shared_ptr<ShortRateDynamics>( new Dynamics( dynamics_, shared_ptr<PhiCurve>( new PhiCurve( *dynamics_, grid ) ) ) );
+	}
+
+	inline shared_ptr<Lattice> GeneralizedG1::tree( const TimeGrid& grid ) const
+	{
+		// phi is known in closed form, so the tree needs no fitting to the term structure
+		shared_ptr<ShortRateDynamics> shortRateDynamics = dynamics( grid );
+		shared_ptr<TrinomialTree> trinomial( new TrinomialTree( shortRateDynamics->process(), grid ) );
+
+		return shared_ptr<Lattice>( new ShortRateTree( trinomial, shortRateDynamics, grid ) );
+	}
 }
 
 #endif // !CALIBRATOR_MODELS_SHORTRATE_GNPP_HPP
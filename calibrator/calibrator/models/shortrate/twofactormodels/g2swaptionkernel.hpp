@@ -0,0 +1,405 @@
+#ifndef CALIBRATOR_MODELS_SHORTRATE_TWOFACTORMODELS_G2SWAPTIONKERNEL_HPP
+#define CALIBRATOR_MODELS_SHORTRATE_TWOFACTORMODELS_G2SWAPTIONKERNEL_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include <ql/math/array.hpp>
+#include <ql/math/solvers1d/brent.hpp>
+#include <ql/termstructures/yieldtermstructure.hpp>
+
+#include <calibrator/global.hpp>
+#include <calibrator/math/batchmath.hpp>
+#include <calibrator/math/integrals/gausslegendreintegral.hpp>
+#include <calibrator/models/shortrate/dynamics/piecewiseconstantintegrals.hpp>
+
+namespace HJCALIBRATOR
+{
+	//! Inputs of the two-factor swaption integral of Brigo Ch. 4.2, on a generic scalar
+	/*! The moments are those of the factors at the expiry under the expiry forward measure.
+	cA holds the coupons times \f$ A(T,t_i) \f$, and Bx, By the \f$ B(T,t_i) \f$ of each factor.
+	*/
+	template <class T>
+	struct G2SwaptionInputs
+	{
+		T mu_x, mu_y;
+		T sigma_x, sigma_y;
+		T rho_xy;
+		std::vector<T> cA, Bx, By;
+		Real w;		// 1 for a payer, -1 for a receiver
+	};
+
+	//! Buffers of a price, so that neither its inputs nor the evaluations of the integrand allocate
+	/*! local() returns the workspace of the calling thread, which is kept across prices and only grows
+	with the number of coupons. growths() counts these growths in the calling thread, so that it stays
+	constant over any loop of GeneralizedG2::swaption once the longest swaption has been priced. Neither
+	the scratch of the dynamics, e.g. the per-factor exponentials of their moments, nor the copy of an
+	integrator other than the Gauss-Hermite rule is counted.
+	payTimes and inputs hold the swaption being priced, and exponentials and probabilities are the strips
+	handed to batchExp and batchNormalCdf.
+	*/
+	template <class T>
+	class G2SwaptionWorkspace
+	{
+	public:
+		std::vector<Time> payTimes;
+		G2SwaptionInputs<T> inputs;
+		std::vector<T> lambda, kappa;
+		std::vector<Real> passiveLambda, passiveBy;
+		std::vector<Real> exponentials, probabilities;
+
+		//! Grows the buffers to n coupons if they are shorter
+		void reserve( Size n )
+		{
+			if ( lambda.size() >= n )
+				return;
+
+			payTimes.reserve( n );
+			inputs.cA.reserve( n );
+			inputs.Bx.reserve( n );
+			inputs.By.reserve( n );
+			lambda.resize( n );
+			kappa.resize( n );
+			passiveLambda.resize( n );
+			passiveBy.resize( n );
+			exponentials.resize( n );
+			probabilities.resize( n + 1 );
+			++counter();
+		}
+
+		static G2SwaptionWorkspace& local()
+		{
+			static thread_local G2SwaptionWorkspace workspace;
+			return workspace;
+		}
+
+		static Size growths() { return counter(); }
+
+	private:
+		static Size& counter()
+		{
+			static thread_local Size count = 0;
+			return count;
+		}
+	};
+
+	//! Value of a scalar without its derivative information
+	/*! An automatic differentiation type provides its own overload, found by argument dependent lookup. */
+	inline Real passiveValue( Real x )
+	{
+		return x;
+	}
+
+	//! Standard normal cumulative distribution written on the scalar type
+	template <class T>
+	inline T g2SwaptionCdf( const T& x )
+	{
+		using std::erfc;
+		return 0.5 * erfc( -x * M_SQRT1_2 );
+	}
+
+	//! Root ybar of the exercise hyperplane \f$ h(y) = 1 - \sum_i \lambda_i e^{-B_i y} \f$
+	/*! h is increasing and concave as soon as the \f$ \lambda_i B_i \f$ are positive, and its two derivatives
+	come with the exponentials, so that a Halley iteration converges in a few steps. It starts from the
+	better of the root at the previous abscissa, given in ybar, and of the guess exact for equal \f$ B_i \f$,
+	\f$ \ln(\sum_i \lambda_i) / \bar{B} \f$ with \f$ \bar{B} \f$ the \f$ \lambda \f$-weighted mean of the \f$ B_i \f$.
+	A step leaving the bracket of the root is replaced by a bisection, and Brent over [-100, 100] is the
+	fallback if h turns out not to be increasing.
+
+	The exponentials of each evaluation are kept in the n values of scratch, taken as one strip by batchExp
+	in a vectorised build.
+	*/
+	inline Real g2SwaptionBoundary( const Real* lambda, const Real* By, Size n, Real ybar, Real* scratch )
+	{
+		const Real accuracy = 1e-10;
+		const Size maxIterations = 50;
+
+		auto hyperplane = [n, lambda, By, scratch]( Real y, Real& d1, Real& d2 )
+		{
+		#if defined( CALIBRATOR_VECTORISED_MATH )
+			for ( Size i = 0; i < n; i++ )
+			{
+				scratch[i] = -By[i] * y;
+			}
+
+			batchExp( scratch, scratch, n );
+		#else
+			for ( Size i = 0; i < n; i++ )
+			{
+				scratch[i] = std::exp( -By[i] * y );
+			}
+		#endif
+
+			Real value = 1.;
+			d1 = d2 = 0.;
+			for ( Size i = 0; i < n; i++ )
+			{
+				Real term = lambda[i] * scratch[i];
+				value -= term;
+				d1 += By[i] * term;
+				d2 -= By[i] * By[i] * term;
+			}
+
+			return value;
+		};
+
+		Real lower = -100.0, upper = 100.0;
+
+		Real sumLambda = 0., sumLambdaB = 0.;
+		for ( Size i = 0; i < n; i++ )
+		{
+			sumLambda += lambda[i];
+			sumLambdaB += lambda[i] * By[i];
+		}
+
+		Real d1, d2;
+		Real y = std::min( std::max( ybar, lower ), upper );
+		Real h = hyperplane( y, d1, d2 );
+
+		if ( sumLambda > 0. && sumLambdaB > 0. )
+		{
+			Real guess = std::min( std::max( std::log( sumLambda ) * sumLambda / sumLambdaB, lower ), upper );
+			Real g1, g2;
+			Real hguess = hyperplane( guess, g1, g2 );
+
+			if ( std::fabs( hguess ) < std::fabs( h ) )
+			{
+				y = guess;
+				h = hguess;
+				d1 = g1;
+				d2 = g2;
+			}
+		}
+
+		for ( Size k = 0; k < maxIterations && d1 > 0.; k++ )
+		{
+			if ( h == 0. )
+				return y;
+
+			if ( h < 0. )
+				lower = y;
+			else
+				upper = y;
+
+			Real denominator = 2. * d1 * d1 - h * d2;
+			Real step = denominator > 0. ? 2. * h * d1 / denominator : h / d1;
+			Real next = y - step;
+
+			if ( !(next > lower && next < upper) )
+				next = 0.5 * (lower + upper);
+
+			if ( std::fabs( next - y ) < accuracy )
+				return next;
+
+			y = next;
+			h = hyperplane( y, d1, d2 );
+		}
+
+		Brent solver;
+		solver.setMaxEvaluations( 1000 );
+		return solver.solve( [&hyperplane]( Real y ) { Real d1, d2; return hyperplane( y, d1, d2 ); },
+							 1e-6, 0.00, -100.0, 100.0 );
+	}
+
+	//! Value of the swaption at expiry conditional on the first factor x, integrated over the second one
+	/*! ybar is solved on the passive values. The derivative of the integrand with respect to ybar
+	is proportional to the hyperplane equation, which vanishes at ybar, so that the adjoint does not flow
+	through the solver and the sensitivities are exact nonetheless.
+
+	On input, ybar is the root at the previous abscissa, or any guess, and on output the root at x.
+	*/
+	template <class T>
+	T g2SwaptionConditionalValue( const G2SwaptionInputs<T>& in, const T& x, Real& ybar, G2SwaptionWorkspace<T>& workspace )
+	{
+		using std::exp;
+		using std::sqrt;
+
+		Size n = in.cA.size();
+
+		T dev = (x - in.mu_x) / in.sigma_x;
+		T rhosqrt = sqrt( 1 - in.rho_xy * in.rho_xy );
+
+		workspace.reserve( n );
+		std::vector<T>& lambda = workspace.lambda;
+		std::vector<T>& kappa = workspace.kappa;
+		std::vector<Real>& passiveLambda = workspace.passiveLambda;
+		std::vector<Real>& passiveBy = workspace.passiveBy;
+
+		for ( Size i = 0; i < n; i++ )
+		{
+			lambda[i] = in.cA[i] * exp( -in.Bx[i] * x );
+			kappa[i] = -in.By[i] * (in.mu_y - 0.5 * rhosqrt * rhosqrt * in.sigma_y * in.sigma_y * in.By[i]
+									+ in.rho_xy * in.sigma_y * dev);
+
+			passiveLambda[i] = passiveValue( lambda[i] );
+			passiveBy[i] = passiveValue( in.By[i] );
+		}
+
+		ybar = g2SwaptionBoundary( passiveLambda.data(), passiveBy.data(), n, ybar, workspace.exponentials.data() );
+
+		T h1 = (ybar - in.mu_y) / (in.sigma_y * rhosqrt) - in.rho_xy * dev / rhosqrt;
+
+		T val = g2SwaptionCdf( T( -in.w * h1 ) );
+		for ( Size i = 0; i < n; i++ )
+		{
+			T h2 = h1 + in.By[i] * in.sigma_y * rhosqrt;
+
+			val -= lambda[i] * exp( kappa[i] ) * g2SwaptionCdf( T( -in.w * h2 ) );
+		}
+
+		return val;
+	}
+
+	//! Conditional value on plain values, with the coupon strips vectorised
+	/*! The same computation as the generic one, but the \f$ e^{-B_{x,i}x} \f$, the \f$ e^{\kappa_i} \f$
+	and the \f$ \Phi(-wh_2) \f$ of all the coupons are each taken as one strip by batchExp and
+	batchNormalCdf, 4 or 8 lanes at a time depending on the instruction set of the build. A scalar
+	build prices plain values with the generic overload, whose exponentials are taken in place.
+	*/
+	#if defined( CALIBRATOR_VECTORISED_MATH )
+	inline Real g2SwaptionConditionalValue( const G2SwaptionInputs<Real>& in, Real x, Real& ybar, G2SwaptionWorkspace<Real>& workspace )
+	{
+		Size n = in.cA.size();
+
+		Real dev = (x - in.mu_x) / in.sigma_x;
+		Real rhosqrt = std::sqrt( 1 - in.rho_xy * in.rho_xy );
+
+		workspace.reserve( n );
+		Real* lambda = workspace.lambda.data();
+		Real* kappa = workspace.kappa.data();
+		Real* probabilities = workspace.probabilities.data();
+
+		for ( Size i = 0; i < n; i++ )
+		{
+			lambda[i] = -in.Bx[i] * x;
+			kappa[i] = -in.By[i] * (in.mu_y - 0.5 * rhosqrt * rhosqrt * in.sigma_y * in.sigma_y * in.By[i]
+									+ in.rho_xy * in.sigma_y * dev);
+		}
+
+		batchExp( lambda, lambda, n );
+		batchExp( kappa, kappa, n );
+
+		for ( Size i = 0; i < n; i++ )
+		{
+			lambda[i] *= in.cA[i];
+		}
+
+		ybar = g2SwaptionBoundary( lambda, in.By.data(), n, ybar, workspace.exponentials.data() );
+
+		Real h1 = (ybar - in.mu_y) / (in.sigma_y * rhosqrt) - in.rho_xy * dev / rhosqrt;
+
+		// the first probability is that of h1, followed by those of the coupons
+		probabilities[0] = -in.w * h1;
+		for ( Size i = 0; i < n; i++ )
+		{
+			probabilities[i + 1] = -in.w * (h1 + in.By[i] * in.sigma_y * rhosqrt);
+		}
+
+		batchNormalCdf( probabilities, probabilities, n + 1 );
+
+		Real val = probabilities[0];
+		for ( Size i = 0; i < n; i++ )
+		{
+			val -= lambda[i] * kappa[i] * probabilities[i + 1];
+		}
+
+		return val;
+	}
+	#endif
+
+	//! Integrand in the first factor, the conditional value times the unnormalized gaussian density
+	template <class T>
+	T g2SwaptionIntegrand( const G2SwaptionInputs<T>& in, const T& x, Real& ybar, G2SwaptionWorkspace<T>& workspace )
+	{
+		using std::exp;
+
+		T dev = (x - in.mu_x) / in.sigma_x;
+
+		return exp( -0.5 * dev * dev ) * g2SwaptionConditionalValue( in, x, ybar, workspace );
+	}
+
+	//! Integral over mu_x +- significance sigma_x divided by the density normalization
+	/*! The abscissas of the rule are mapped onto the integration range on the scalar type, so that every
+	operation is recorded by an automatic differentiation type, which Integrator working on Real cannot do.
+	*/
+	template <class T>
+	T g2SwaptionIntegral( const G2SwaptionInputs<T>& in, Real significance, const GaussLegendreIntegral& quadrature )
+	{
+		T sum = 0;
+		Real ybar = 0.;
+		G2SwaptionWorkspace<T>& workspace = G2SwaptionWorkspace<T>::local();
+		for ( Size k = 0; k < quadrature.order(); k++ )
+		{
+			T x = in.mu_x + significance * in.sigma_x * quadrature.x()[k];
+			sum += quadrature.weights()[k] * g2SwaptionIntegrand( in, x, ybar, workspace );
+		}
+
+		// dx = significance sigma_x dxi, so that sigma_x cancels with the normalization
+		return significance * sum / std::sqrt( 2. * M_PI );
+	}
+
+	//! Expectation of the conditional value over x by a Gauss-Hermite rule for the weight \f$ e^{-\xi^2} \f$
+	/*! With \f$ x = \mu_x + \sqrt{2}\sigma_x\xi \f$ the gaussian density is exactly the weight of the rule,
+	so that the order is the number of boundary solves, whatever the significance would have been.
+	*/
+	template <class T>
+	T g2SwaptionHermiteIntegral( const G2SwaptionInputs<T>& in, const Array& abscissas, const Array& weights )
+	{
+		T sum = 0;
+		Real ybar = 0.;
+		G2SwaptionWorkspace<T>& workspace = G2SwaptionWorkspace<T>::local();
+		for ( Size k = 0; k < abscissas.size(); k++ )
+		{
+			T x = in.mu_x + M_SQRT2 * in.sigma_x * abscissas[k];
+			sum += weights[k] * g2SwaptionConditionalValue( in, x, ybar, workspace );
+		}
+
+		return sum / std::sqrt( M_PI );
+	}
+
+	//! European swaption price in the two-factor model with piecewise constant integrals
+	/*! The coupons are paid at payTimes with accruals from the expiry, as in GeneralizedG2::swaption.
+	With an automatic differentiation type, one adjoint sweep returns the sensitivities of the price to all
+	the mean reversions, volatilities and correlations of the integrals.
+	*/
+	template <class T>
+	T g2Swaption( const PiecewiseConstantIntegrals<T>& integrals,
+				  const Handle<YieldTermStructure>& termStructure,
+				  Time expiry, const std::vector<Time>& payTimes,
+				  Real strike, Real w, Real nominal,
+				  Real significance, const GaussLegendreIntegral& quadrature )
+	{
+		using std::exp;
+		using std::sqrt;
+
+		Size n = payTimes.size();
+		Real P0T = termStructure->discount( expiry );
+
+		G2SwaptionInputs<T> in;
+		in.w = w;
+		in.cA.resize( n );
+		in.Bx.resize( n );
+		in.By.resize( n );
+
+		for ( Size i = 0; i < n; i++ )
+		{
+			Time tau_i = i == 0 ? payTimes[i] - expiry : payTimes[i] - payTimes[i - 1];
+			Real c = i == n - 1 ? 1 + strike * tau_i : strike * tau_i;
+
+			in.cA[i] = c * termStructure->discount( payTimes[i] ) / P0T * exp( integrals.logA( expiry, payTimes[i] ) );
+			in.Bx[i] = integrals.B( 0, expiry, payTimes[i] );
+			in.By[i] = integrals.B( 1, expiry, payTimes[i] );
+		}
+
+		in.mu_x = integrals.meanTforward( 0, expiry, 0, expiry );
+		in.mu_y = integrals.meanTforward( 1, expiry, 0, expiry );
+		in.sigma_x = sqrt( integrals.variance( 0, 0, 0, expiry ) );
+		in.sigma_y = sqrt( integrals.variance( 1, 1, 0, expiry ) );
+		in.rho_xy = integrals.variance( 0, 1, 0, expiry ) / in.sigma_x / in.sigma_y;
+
+		return nominal * w * P0T * g2SwaptionIntegral( in, significance, quadrature );
+	}
+}
+
+#endif // !CALIBRATOR_MODELS_SHORTRATE_TWOFACTORMODELS_G2SWAPTIONKERNEL_HPP
@@ -1,19 +1,27 @@
+#include <algorithm>
+#include <map>
+#include <typeinfo>
+
 #include <boost/bind.hpp>
 
 #include <ql/time/date.hpp>
 #include <ql/time/daycounter.hpp>
 #include <ql/pricingengines/blackformula.hpp>
-#include <ql/math/solvers1d/brent.hpp>
-#include <ql/math/distributions/normaldistribution.hpp>
 #include <ql/math/integrals/segmentintegral.hpp>
+#include <ql/math/integrals/gaussianquadratures.hpp>
 
+#include <calibrator/math/integrals/integratorcopy.hpp>
 #include <calibrator/models/shortrate/twofactormodels/generalg2.hpp>
+#include <calibrator/models/shortrate/dynamics/gaussianfactor/g++constant.hpp>
+#include <calibrator/models/shortrate/dynamics/gaussianfactor/g++cmr_pcv.hpp>
+#include <calibrator/models/shortrate/dynamics/gaussianfactor/g++cmr_plv.hpp>
+#include <calibrator/models/shortrate/dynamics/gaussianfactor/g++tdmr_pcv.hpp>
 
 namespace HJCALIBRATOR
 {
-	GeneralizedG2::GeneralizedG2( boost::shared_ptr<Gaussian2FactorDynamics> dynamics,
+	GeneralizedG2::GeneralizedG2( const boost::shared_ptr<Gaussian2FactorDynamics>& dynamics,
 								  Real integralSignificance,
-								  boost::shared_ptr<Integrator> integrator )
+								  const boost::shared_ptr<Integrator>& integrator )
 		: TwoFactorModel( 5 )
 		, AffineModel()
 		, TermStructureConsistentModel( dynamics->termStructure() )
@@ -22,7 +30,10 @@ namespace HJCALIBRATOR
 		, rho_( arguments_[4] )
 		, integralSignificance_( integralSignificance )
 		, integrator_( integrator )
+		, copyableIntegrator_( copyIntegrator( *integrator ) != nullptr )
 		, dynamics_( dynamics )
+		, family_( family( *dynamics ) )
+		, fixedVersion_( 0 )
 	{
 		a_ = dynamics->a(0);
 		b_ = dynamics->a(1);
@@ -35,6 +46,94 @@ namespace HJCALIBRATOR
 		registerWith( dynamics->termStructure() );
 	}
 
+	namespace
+	{
+		//! The calls used by the kernels, qualified so that they are bound statically
+		/*! Only valid when FactorDynamics is the exact type of the dynamics, whose
+		implementations are then the final overriders. */
+		template <class FactorDynamics>
+		class ExactDynamics
+		{
+		public:
+			typedef GaussianFactorDynamics::Moments Moments;
+
+			explicit ExactDynamics( const FactorDynamics& dynamics ) : dynamics_( dynamics ) {}
+
+			Real B( Size i, Time t, Time T ) const { return dynamics_.FactorDynamics::B( i, t, T ); }
+			Real variance( Size i, Size j, Time s, Time t ) const { return dynamics_.FactorDynamics::variance( i, j, s, t ); }
+
+			void A( Time t, const TimeVector& T, RealVector& result ) const { dynamics_.FactorDynamics::A( t, T, result ); }
+			void B( Size i, Time t, const TimeVector& T, RealVector& result ) const { dynamics_.FactorDynamics::B( i, t, T, result ); }
+			void moments( Time s, Time t, Time T, GaussianFactorDynamics::Moments& result ) const
+			{
+				dynamics_.FactorDynamics::moments( s, t, T, result );
+			}
+
+		private:
+			const FactorDynamics& dynamics_;
+		};
+
+		template <class FactorDynamics>
+		ExactDynamics<FactorDynamics> exact( const Gaussian2FactorDynamics& dynamics )
+		{
+			return ExactDynamics<FactorDynamics>( static_cast<const FactorDynamics&>( dynamics ) );
+		}
+	}
+
+	// a class derived from a shipped family may override any of its calls, so it is generic
+	GeneralizedG2::Family GeneralizedG2::family( const Gaussian2FactorDynamics& dynamics )
+	{
+		const std::type_info& type = typeid(dynamics);
+
+		if ( type == typeid(G2ConstantDynamics) )
+			return Constant;
+		if ( type == typeid(G2PPPCMRPCV) )
+			return PiecewiseConstantVolatility;
+		if ( type == typeid(G2PPPCMRPLV) )
+			return PiecewiseLinearVolatility;
+		if ( type == typeid(G2PPTDMRPCV) )
+			return TimeDependentMeanReversion;
+
+		return Generic;
+	}
+
+	template <class Kernel>
+	Real GeneralizedG2::dispatch( const Gaussian2FactorDynamics& dynamics, const Kernel& kernel ) const
+	{
+		QL_REQUIRE( &dynamics == dynamics_.get() || typeid(dynamics) == typeid(*dynamics_),
+					"The dynamics given is not a copy of the dynamics of the model." );
+
+		switch ( family_ )
+		{
+		case Constant:
+			if ( &dynamics == dynamics_.get() )
+				return kernel( fixedDynamics() );
+			return kernel( exact<G2ConstantDynamics>( dynamics ) );
+		case PiecewiseConstantVolatility:
+			if ( &dynamics == dynamics_.get() )
+				return kernel( fixedDynamics() );
+			return kernel( exact<G2PPPCMRPCV>( dynamics ) );
+		case PiecewiseLinearVolatility:
+			return kernel( exact<G2PPPCMRPLV>( dynamics ) );
+		case TimeDependentMeanReversion:
+			return kernel( exact<G2PPTDMRPCV>( dynamics ) );
+		default:
+			return kernel( dynamics );
+		}
+	}
+
+	const FixedFactorDynamics<2>& GeneralizedG2::fixedDynamics() const
+	{
+		// rebuilt lazily, as the segment indices of the dynamics are
+		if ( !fixed_ || fixedVersion_ != dynamics_->version() )
+		{
+			fixed_.reset( new FixedFactorDynamics<2>( *dynamics_ ) );
+			fixedVersion_ = dynamics_->version();
+		}
+
+		return *fixed_;
+	}
+
 	void GeneralizedG2::generateArguments() 
 	{
 		dynamics_->a( a_, 0 );
@@ -44,6 +143,32 @@ namespace HJCALIBRATOR
 		dynamics_->rho( rho_, 1, 0 );
 	}
 
+	void GeneralizedG2::gaussHermiteOrder( Size order )
+	{
+		if ( order == gaussHermiteOrder() )
+			return;
+
+		if ( order == 0 )
+		{
+			hermiteAbscissas_ = Array();
+			hermiteWeights_ = Array();
+		}
+		else
+		{
+			GaussHermiteIntegration rule( order );
+			hermiteAbscissas_ = rule.x();
+			hermiteWeights_ = rule.weights();
+		}
+
+		// the swaption prices of the engines change with the rule
+		notifyObservers();
+	}
+
+	void GeneralizedG2::publish()
+	{
+		published_.publish( *dynamics_ );
+	}
+
 	Real GeneralizedG2::A( Time t, Time T ) const
 	{
 		return dynamics_->A( t, T );
@@ -68,41 +193,31 @@ namespace HJCALIBRATOR
 											Time maturity,
 											Time bondMaturity ) const
 	{
-		auto dynamics = dynamics_;
-
-		Real Bx = dynamics->B( 0, maturity, bondMaturity );
-		Real By = dynamics->B( 1, maturity, bondMaturity );
-		Real rho = dynamics->rho( 0, 1 )(0.0);
-
-		Real Vpratio = 0;
-
-		auto integrand00 = [maturity, dynamics]( Time u )
-		{
-			Real sigma = dynamics->sigma( 0 )(u);
-			Real E = dynamics->E( 0, u, maturity );
-			
-			return sigma * sigma / E / E;
-		};
-
-		Vpratio += Bx * By * integrator_->operator()( integrand00, 0, maturity );
+		return discountBondOption( *dynamics_, type, strike, maturity, bondMaturity );
+	}
 
-		auto integrand11 = [maturity, dynamics]( Time u )
+	Real GeneralizedG2::discountBondOption( const Gaussian2FactorDynamics& frozen,
+											Option::Type type, Real strike,
+											Time maturity, Time bondMaturity ) const
+	{
+		return dispatch( frozen, [&]( const auto& dynamics )
 		{
-			Real sigma = dynamics->sigma( 1 )(u);
-			Real E = dynamics->E( 1, u, maturity );
-
-			return sigma * sigma / E / E;
-		};
-
-		Vpratio += Bx * By * integrator_->operator()( integrand11, 0, maturity );
+			return evaluateDiscountBondOption( dynamics, type, strike, maturity, bondMaturity );
+		} );
+	}
 
-		auto integrand01 = [maturity, dynamics]( Time u )
-		{
-			return dynamics->sigma( 0 )(u) * dynamics->sigma( 1 )(u) 
-				/ dynamics->E( 0, u, maturity ) / dynamics->E( 1, u, maturity );
-		};
+	template <class FactorDynamics>
+	Real GeneralizedG2::evaluateDiscountBondOption( const FactorDynamics& dynamics,
+													Option::Type type, Real strike,
+													Time maturity, Time bondMaturity ) const
+	{
 
-		Vpratio += 2 * Bx * Bx * rho * integrator_->operator()( integrand01, 0, maturity );
+		Real Bx = dynamics.B( 0, maturity, bondMaturity );
+		Real By = dynamics.B( 1, maturity, bondMaturity );
+		// the pairwise variances include the correlation
+		Real Vpratio = Bx * Bx * dynamics.variance( 0, 0, 0, maturity )
+			+ By * By * dynamics.variance( 1, 1, 0, maturity )
+			+ 2 * Bx * By * dynamics.variance( 0, 1, 0, maturity );
 
 		Real stdDev = sqrt( std::max( Vpratio, 0.0 ) );
 
@@ -124,93 +239,220 @@ namespace HJCALIBRATOR
 
 	// Brigo Ch. 4.2
 	Real GeneralizedG2::swaption( const Swaption::arguments& arg, Real strike ) const
+	{
+		return swaption( *dynamics_, arg, strike );
+	}
+
+	Real GeneralizedG2::swaption( const Gaussian2FactorDynamics& frozen, const Swaption::arguments& arg, Real strike ) const
+	{
+		QL_REQUIRE( !hermiteAbscissas_.empty() || copyableIntegrator_,
+					"Concurrent swaption calls need the Gauss-Hermite rule or an integrator that can be copied." );
+
+		return dispatch( frozen, [&]( const auto& dynamics )
+		{
+			return evaluateSwaption( dynamics, arg, strike );
+		} );
+	}
+
+	void GeneralizedG2::swaptions( const std::vector<Swaption::arguments>& args,
+								   const RealVector& strikes,
+								   RealVector& values ) const
+	{
+		QL_REQUIRE( args.size() == strikes.size(), "One strike is required per swaption." );
+
+		dispatch( *dynamics_, [&]( const auto& dynamics )
+		{
+			evaluateSwaptions( dynamics, args, strikes, values );
+			return 0.0;
+		} );
+	}
+
+	void GeneralizedG2::swaptionTimes( const Swaption::arguments& arg, Time& expiry, TimeVector& payTimes ) const
 	{
 		Date settlement = termStructure()->referenceDate();
 		DayCounter dayCounter = termStructure()->dayCounter();
-		Time T = dayCounter.yearFraction( settlement,
-											  arg.floatingResetDates[0] );
-		Real w = (arg.type == VanillaSwap::Payer ? 1 : -1);
+		expiry = dayCounter.yearFraction( settlement,
+										  arg.floatingResetDates[0] );
 
-		std::vector<Time> t;
+		payTimes.clear();
 		for ( auto fixedPayDate : arg.fixedPayDates )
 		{
-			t.push_back( dayCounter.yearFraction( settlement,
-													fixedPayDate ) );
+			payTimes.push_back( dayCounter.yearFraction( settlement,
+														 fixedPayDate ) );
+		}
+	}
+
+	Real GeneralizedG2::swaptionCoupon( Real strike, Time expiry, const TimeVector& payTimes, Size i )
+	{
+		Time tau_i = i == 0 ? payTimes[i] - expiry : payTimes[i] - payTimes[i - 1];
+		return i == payTimes.size() - 1 ? 1 + strike * tau_i : strike * tau_i;
+	}
+
+	template <class Moments>
+	void GeneralizedG2::swaptionMoments( const Moments& moments, G2SwaptionInputs<Real>& in )
+	{
+		in.mu_x = moments.mean[0];
+		in.mu_y = moments.mean[1];
+		in.sigma_x = sqrt( moments.variance[0][0] );
+		in.sigma_y = sqrt( moments.variance[1][1] );
+		in.rho_xy = moments.variance[0][1] / in.sigma_x / in.sigma_y;
+	}
+
+	Real GeneralizedG2::swaptionIntegral( const G2SwaptionInputs<Real>& in ) const
+	{
+		if ( !hermiteAbscissas_.empty() )
+			return g2SwaptionHermiteIntegral( in, hermiteAbscissas_, hermiteWeights_ );
+
+		// the integrand is shared with the automatic differentiation path of g2Swaption
+		// the integrator visits neighbouring abscissas in turn, whose roots start the next solve
+		struct State
+		{
+			const G2SwaptionInputs<Real>& in;
+			Real ybar;
+			G2SwaptionWorkspace<Real>& workspace;
+		} state = { in, 0., G2SwaptionWorkspace<Real>::local() };
+
+		// a single reference is captured, so that the function wrapper of the integrator stores it in place
+		auto integrand = [&state]( Real x )
+		{
+			return g2SwaptionIntegrand( state.in, x, state.ybar, state.workspace );
+		};
+
+		Real upper = in.mu_x + integralSignificance_ * in.sigma_x;
+		Real lower = in.mu_x - integralSignificance_ * in.sigma_x;
+
+		// a copy per call, since the integrator records its last call and prices may run concurrently
+		Real integral = copyableIntegrator_ ? integrateOnCopy( *integrator_, integrand, lower, upper )
+											: (*integrator_)( integrand, lower, upper );
+
+		return integral / sqrt( 2. * M_PI ) / in.sigma_x;
+	}
+
+	template <class FactorDynamics>
+	Real GeneralizedG2::evaluateSwaption( const FactorDynamics& dynamics, const Swaption::arguments& arg, Real strike ) const
+	{
+		// the buffers of the thread, which hold the previous price and already have its size
+		G2SwaptionWorkspace<Real>& workspace = G2SwaptionWorkspace<Real>::local();
+		workspace.reserve( arg.fixedPayDates.size() );
+
+		Time T;
+		TimeVector& t = workspace.payTimes;
+		swaptionTimes( arg, T, t );
+
+		G2SwaptionInputs<Real>& in = workspace.inputs;
+		in.w = (arg.type == VanillaSwap::Payer ? 1 : -1);
+		dynamics.A( T, t, in.cA );
+		dynamics.B( 0, T, t, in.Bx );
+		dynamics.B( 1, T, t, in.By );
+
+		for ( Size i = 0; i < t.size(); i++ )
+		{
+			in.cA[i] *= swaptionCoupon( strike, T, t, i );
 		}
-		Size N_timestep = t.size();
-		
-		Array cA( N_timestep );
-		Array Bx( N_timestep );
-		Array By( N_timestep );
 
-		for ( Size i = 0; i < N_timestep; i++ )
+		// sized on the first price of the thread
+		static thread_local typename FactorDynamics::Moments moments;
+		dynamics.moments( 0, T, T, moments );
+		swaptionMoments( moments, in );
+
+		Real N = arg.nominal;
+		Real P0T = termStructure()->discount( T );
+
+		return N * in.w * P0T * swaptionIntegral( in );
+	}
+
+	template <class FactorDynamics>
+	void GeneralizedG2::evaluateSwaptions( const FactorDynamics& dynamics,
+										   const std::vector<Swaption::arguments>& args,
+										   const RealVector& strikes,
+										   RealVector& values ) const
+	{
+		values.assign( args.size(), 0.0 );
+
+		std::vector<Time> expiries( args.size() );
+		std::vector<TimeVector> payTimes( args.size() );
+		std::map<Time, std::vector<Size>> groups;
+
+		for ( Size k = 0; k < args.size(); k++ )
 		{
-			Time tau_i = i == 0 ? t[i] - T : t[i] - t[i - 1];
-			Real c = i == N_timestep - 1 ? 1 + strike * tau_i : strike * tau_i;
-			cA[i] = c * dynamics_->A( T, t[i] );
-			Bx[i] = dynamics_->B( 0, T, t[i] );
-			By[i] = dynamics_->B( 1, T, t[i]);
+			swaptionTimes( args[k], expiries[k], payTimes[k] );
+			groups[expiries[k]].push_back( k );
 		}
 
-		Real mu_x = dynamics_->meanTforward( 0, T, 0, T );
-		Real mu_y = dynamics_->meanTforward( 1, T, 0, T );
-		Real sigma_x = sqrt(dynamics_->variance( 0, 0, 0, T ));
-		Real sigma_y = sqrt(dynamics_->variance( 1, 1, 0, T ));
-		Real rho = dynamics_->rho( 0, 1 )(0.0);
-		Real var = dynamics_->variance( 0, 1, 0, T );
-		Real rho_xy = rho * var / sigma_x / sigma_y;
-		Real rhosqrt = sqrt( 1 - rho_xy * rho_xy );
+		typename FactorDynamics::Moments moments;
+		TimeVector t;
+		RealVector A, Bx, By;
 
-		auto integrand = [&, N_timestep, w, mu_x, mu_y, sigma_x, sigma_y, rho_xy, rhosqrt]( Real x )
+		for ( const auto& group : groups )
 		{
-			Real dev = (x - mu_x) / sigma_x;
+			Time T = group.first;
+			const std::vector<Size>& members = group.second;
 
-			Array lambda( N_timestep );
-			Array kappa( N_timestep );
-			for ( Size i = 0; i < N_timestep; i++ )
+			// the pay dates of all the tenors of the expiry, whose A and B are evaluated once
+			t.clear();
+			for ( Size k : members )
 			{
-				lambda[i] = cA[i] * exp( -Bx[i] * x );
-				kappa[i] = -By[i] * (mu_y - 0.5 * rhosqrt * rhosqrt * sigma_y * sigma_y * By[i]
-											+ rho_xy * sigma_y * (x - mu_x) / sigma_x);
+				t.insert( t.end(), payTimes[k].begin(), payTimes[k].end() );
 			}
+			std::sort( t.begin(), t.end() );
+			t.erase( std::unique( t.begin(), t.end() ), t.end() );
+
+			dynamics.A( T, t, A );
+			dynamics.B( 0, T, t, Bx );
+			dynamics.B( 1, T, t, By );
+
+			dynamics.moments( 0, T, T, moments );
+			Real P0T = termStructure()->discount( T );
 
-			auto hyperplane = [N_timestep, &lambda, &By]( Real y )
+			std::vector<G2SwaptionInputs<Real>> inputs( members.size() );
+			for ( Size m = 0; m < members.size(); m++ )
 			{
-				Real value = 1.;
-				for ( Size i = 0; i < N_timestep; i++ )
-				{
-					Real val = lambda[i] * exp( -By[i] * y );
-					value -= val;
-				}
+				const Swaption::arguments& arg = args[members[m]];
+				const TimeVector& tenor = payTimes[members[m]];
+				G2SwaptionInputs<Real>& in = inputs[m];
 
-				return value;
-			};
+				in.w = (arg.type == VanillaSwap::Payer ? 1 : -1);
+				swaptionMoments( moments, in );
 
-			Brent solver;
-			solver.setMaxEvaluations( 1000 );
-			Real ybar = solver.solve( hyperplane, 1e-6, 0.00, -100.0, 100.0 );
+				for ( Size i = 0; i < tenor.size(); i++ )
+				{
+					Size j = std::lower_bound( t.begin(), t.end(), tenor[i] ) - t.begin();
 
-			Real h1 = (ybar - mu_y) / (sigma_y * rhosqrt)
-				- rho_xy * (x - mu_x) / (sigma_x * rhosqrt);
+					in.cA.push_back( A[j] * swaptionCoupon( strikes[members[m]], T, tenor, i ) );
+					in.Bx.push_back( Bx[j] );
+					in.By.push_back( By[j] );
+				}
+			}
 
-			CumulativeNormalDistribution Phi;
-			Real val = Phi( -w * h1 );
-			for ( Size i = 0; i < N_timestep; i++ )
+			if ( hermiteAbscissas_.empty() )
 			{
-				Real h2 = h1 + By[i] * sigma_y * rhosqrt;
-
-				val -= lambda[i] * exp( kappa[i] ) * Phi( -w * h2 );
+				for ( Size m = 0; m < members.size(); m++ )
+				{
+					values[members[m]] = args[members[m]].nominal * inputs[m].w * P0T * swaptionIntegral( inputs[m] );
+				}
+				continue;
 			}
 
-			return exp( -0.5*dev*dev ) * val;
-		};
+			// every tenor on the same abscissas, each one warm starting its own boundary
+			RealVector sums( members.size(), 0.0 ), ybar( members.size(), 0.0 );
+			G2SwaptionWorkspace<Real>& workspace = G2SwaptionWorkspace<Real>::local();
+			Real mu_x = inputs[0].mu_x;
+			Real sigma_x = inputs[0].sigma_x;
 
-		Real N = arg.nominal;
-		Real P0T = termStructure()->discount( T );
-		Real upper = mu_x + integralSignificance_ *sigma_x;
-		Real lower = mu_x - integralSignificance_ *sigma_x;
+			for ( Size q = 0; q < hermiteAbscissas_.size(); q++ )
+			{
+				Real x = mu_x + M_SQRT2 * sigma_x * hermiteAbscissas_[q];
 
-		Real val = N * w * P0T * integrator_->operator()( integrand, lower, upper ) / sqrt( 2. * M_PI ) / sigma_x;
-		return val;
+				for ( Size m = 0; m < members.size(); m++ )
+				{
+					sums[m] += hermiteWeights_[q] * g2SwaptionConditionalValue( inputs[m], x, ybar[m], workspace );
+				}
+			}
+
+			for ( Size m = 0; m < members.size(); m++ )
+			{
+				values[members[m]] = args[members[m]].nominal * inputs[m].w * P0T * sums[m] / sqrt( M_PI );
+			}
+		}
 	}
 }
\ No newline at end of file
@@ -11,6 +11,10 @@
 #include <calibrator/global.hpp>
 #include <calibrator/processes/generalornsteinuhlenbeckprocess.hpp>
 #include <calibrator/models/shortrate/dynamics/gaussianfactordynamics.hpp>
+#include <calibrator/models/shortrate/dynamics/fixedfactordynamics.hpp>
+#include <calibrator/models/shortrate/dynamics/phicurve.hpp>
+#include <calibrator/models/shortrate/dynamics/publisheddynamics.hpp>
+#include <calibrator/models/shortrate/twofactormodels/g2swaptionkernel.hpp>
 
 namespace HJCALIBRATOR
 {
@@ -31,8 +35,6 @@ namespace HJCALIBRATOR
 	\bug This class was not tested enough to guarantee
 	its functionality.
 
-	\todo Tree implementation
-
 	\ingroup shortrate
 	*/
 	class GeneralizedG2 : public TwoFactorModel, public AffineModel, public TermStructureConsistentModel
@@ -42,20 +44,19 @@ namespace HJCALIBRATOR
 		shared_ptr<Gaussian2FactorDynamics> dynamics_;
 
 	public:
-		GeneralizedG2( shared_ptr<Gaussian2FactorDynamics> dynamics,
+		GeneralizedG2( const shared_ptr<Gaussian2FactorDynamics>& dynamics,
 					   Real integralSignificance = 10, 
-					   shared_ptr<Integrator> integrator = boost::make_shared<GaussKronrodAdaptive>( GaussKronrodAdaptive( 1.e-8, 10000 ) ) );
+					   const shared_ptr<Integrator>& integrator = boost::make_shared<GaussKronrodAdaptive>( GaussKronrodAdaptive( 1.e-8, 10000 ) ) );
 		virtual ~GeneralizedG2() {}
 
 		// TwoFactorModel virtual override
-		shared_ptr<Lattice> tree( const TimeGrid& grid ) const override
-		{
-			// todo
-			return shared_ptr<Lattice>();
-		};
+		shared_ptr<Lattice> tree( const TimeGrid& grid ) const override;
 
 		shared_ptr<ShortRateDynamics> dynamics() const;
 
+		//! Same as above with phi tabulated on the grid, for lattices and path generation
+		shared_ptr<ShortRateDynamics> dynamics( const TimeGrid& grid ) const;
+
 		virtual DiscountFactor discount( Time t ) const override
 		{
 			return termStructure()->discount( t );
@@ -76,11 +77,46 @@ namespace HJCALIBRATOR
 
 		virtual Real swaption( const Swaption::arguments& arg, Real strike ) const;
 
-		Parameter a() const { return a_; }
-		Parameter b() const { return b_; }
-		Parameter sigma() const { return sigma_; }
-		Parameter eta() const { return eta_; }
-		Parameter rho() const { return rho_; }
+		//! Prices a grid of swaptions, values[k] being swaption( args[k], strikes[k] )
+		/*! The swaptions are grouped by expiry. Per group, the moments of the factors, P(0,T), and A, Bx
+		and By on the union of the pay dates are evaluated once. In the Gauss-Hermite mode every tenor of
+		the group is evaluated on the same abscissas, otherwise each tenor is given to the integrator.
+		*/
+		void swaptions( const std::vector<Swaption::arguments>& args,
+						const RealVector& strikes,
+						RealVector& values ) const;
+
+		//! Integrates swaption() over the first factor by a Gauss-Hermite rule of the given order
+		/*! The gaussian density of the factor is the weight of the rule, so that the price costs exactly
+		order boundary solves, instead of the varying number of calls of the integrator. An order of 0
+		restores the integrator over mu_x +- integralSignificance sigma_x.
+
+		On 1y to 10y expiries and tenors, payers and receivers struck at the money and +- 200bp,
+		the largest relative error against a converged integral is about 1e-5 with 8 nodes, 1e-8
+		with 12 and 1e-11 with 16, beyond which it stays at the rounding level. 16 to 24 nodes are
+		therefore enough, and more only cost solves.
+		*/
+		void gaussHermiteOrder( Size order );
+		Size gaussHermiteOrder() const { return hermiteAbscissas_.size(); }
+
+		//! Freezes the current dynamics and publishes it to the pricing threads, e.g. after a calibration
+		void publish();
+		//! Dynamics published last, null before the first publication
+		shared_ptr<const Gaussian2FactorDynamics> published() const { return published_.current(); }
+
+		//! Same as above on a given frozen dynamics, typically published(), while the model is recalibrated
+		/*! Concurrent swaption calls integrate on copies of the integrator of the model, so without the
+		Gauss-Hermite rule it has to be one of the rules copyIntegrator knows. */
+		Real discountBondOption( const Gaussian2FactorDynamics& frozen,
+								 Option::Type type, Real strike,
+								 Time maturity, Time bondMaturity ) const;
+		Real swaption( const Gaussian2FactorDynamics& frozen, const Swaption::arguments& arg, Real strike ) const;
+
+		ParameterAccess a() const { return a_; }
+		ParameterAccess b() const { return b_; }
+		ParameterAccess sigma() const { return sigma_; }
+		ParameterAccess eta() const { return eta_; }
+		ParameterAccess rho() const { return rho_; }
 
 	protected:
 		// CalibratedModel virtual override
@@ -97,24 +133,75 @@ namespace HJCALIBRATOR
 		Real integralSignificance_;
 
 		shared_ptr<Integrator> integrator_;
+		bool copyableIntegrator_;
+
+		Array hermiteAbscissas_;
+		Array hermiteWeights_;
+
+	private:
+		//! Shipped dynamics families priced by statically dispatched kernels
+		enum Family { Generic, Constant, PiecewiseConstantVolatility, PiecewiseLinearVolatility, TimeDependentMeanReversion };
+
+		static Family family( const Gaussian2FactorDynamics& dynamics );
+
+		//! Calls the kernel with statically bound calls on a shipped family, or on the dynamics as is otherwise
+		/*! The dynamics is the one of the model or a frozen copy of it, which has the same type. The
+		dynamics of the model, of the constant or the piecewise constant volatility family, is given
+		as its FixedFactorDynamics. */
+		template <class Kernel>
+		Real dispatch( const Gaussian2FactorDynamics& dynamics, const Kernel& kernel ) const;
+
+		//! The fixed dimension front end of the dynamics of the model, built again after a parameter update
+		const FixedFactorDynamics<2>& fixedDynamics() const;
+
+		template <class FactorDynamics>
+		Real evaluateDiscountBondOption( const FactorDynamics& dynamics,
+										 Option::Type type, Real strike,
+										 Time maturity, Time bondMaturity ) const;
+
+		template <class FactorDynamics>
+		Real evaluateSwaption( const FactorDynamics& dynamics, const Swaption::arguments& arg, Real strike ) const;
+
+		template <class FactorDynamics>
+		void evaluateSwaptions( const FactorDynamics& dynamics,
+								const std::vector<Swaption::arguments>& args,
+								const RealVector& strikes,
+								RealVector& values ) const;
+
+		void swaptionTimes( const Swaption::arguments& arg, Time& expiry, TimeVector& payTimes ) const;
+		//! Fixed coupon paid at payTimes[i], the notional included at the last date
+		static Real swaptionCoupon( Real strike, Time expiry, const TimeVector& payTimes, Size i );
+		template <class Moments>
+		static void swaptionMoments( const Moments& moments, G2SwaptionInputs<Real>& in );
+		//! Expectation of the conditional value over the first factor, by the rule of the model
+		Real swaptionIntegral( const G2SwaptionInputs<Real>& in ) const;
+
+		Family family_;
+
+		mutable shared_ptr<const FixedFactorDynamics<2>> fixed_;
+		mutable Size fixedVersion_;
+
+		PublishedDynamics<Gaussian2FactorDynamics> published_;
 	};
 
 	//! Short-rate dynamics in the time-dependent Hull-White model
 	/*! The short-rate follows an time-dependent Hull-White process */
 	class GeneralizedG2::Dynamics : public TwoFactorModel::ShortRateDynamics {
 	public:
-		Dynamics( const shared_ptr<Gaussian2FactorDynamics> dynamics )
+		Dynamics( const shared_ptr<Gaussian2FactorDynamics>& dynamics,
+				  const shared_ptr<PhiCurve>& phi = shared_ptr<PhiCurve>() )
 			: ShortRateDynamics( shared_ptr<StochasticProcess1D>( new GeneralizedOrnsteinUhlenbeckProcess( dynamics->a( 0 ), dynamics->sigma( 0 ) ) ),
 								 shared_ptr<StochasticProcess1D>( new GeneralizedOrnsteinUhlenbeckProcess( dynamics->a( 1 ), dynamics->sigma( 1 ) ) ),
 								 dynamics->rho( 0, 1 )(0.0) )
-			, dynamics_( dynamics )
+			, dynamics_( dynamics ), phi_( phi )
 		{}
 
 		virtual Real shortRate( Time t, Real x, Real y ) const {
-			return x + y + dynamics_->phi( t );
+			return x + y + (phi_ ? (*phi_)( t ) : dynamics_->phi( t ));
 		}
 
 		shared_ptr<Gaussian2FactorDynamics> dynamics_;
+		shared_ptr<PhiCurve> phi_;
 	};
 
 	// inline definitions
@@ -122,5 +209,20 @@ namespace HJCALIBRATOR
 	{
 		return shared_ptr<ShortRateDynamics>( new Dynamics( dynamics_ ) );
 	}
+
+	inline shared_ptr<TwoFactorModel::ShortRateDynamics>	GeneralizedG2::dynamics( const TimeGrid& grid ) const
+	{
+		return shared_ptr<ShortRateDynamics>( new Dynamics( dynamics_, shared_ptr<PhiCurve>( new PhiCurve( *dynamics_, grid ) ) ) );
+	}
+
+	inline shared_ptr<Lattice> GeneralizedG2::tree( const TimeGrid& grid ) const
+	{
+		// phi is known in closed form, so the tree needs no fitting to the term structure
+		shared_ptr<ShortRateDynamics> shortRateDynamics = dynamics( grid );
+		shared_ptr<TrinomialTree> tree1( new TrinomialTree( shortRateDynamics->xProcess(), grid ) );
+		shared_ptr<TrinomialTree> tree2( new TrinomialTree( shortRateDynamics->yProcess(), grid ) );
+
+		return shared_ptr<Lattice>( new ShortRateTree( tree1, tree2, shortRateDynamics ) );
+	}
 }
 #endif // !CALIBRATOR_MODELS_SHORTRATE_TWOFACTORMODELS_GENERALG2_HPP
\ No newline at end of file
@@ -1,6 +1,8 @@
 #ifndef HJCALIBRATOR_PRICINGENGINES_SWAPTION_GENERALG2SWAPTIONENGEIN_HPP
 #define HJCALIBRATOR_PRICINGENGINES_SWAPTION_GENERALG2SWAPTIONENGEIN_HPP
 
+#include <map>
+
 #include <ql/pricingengines/genericmodelengine.hpp>
 #include <ql/pricingengines/swap/discountingswapengine.hpp>
 
@@ -26,19 +28,117 @@ namespace HJCALIBRATOR
 			QL_REQUIRE( arguments_.settlementType == Settlement::Physical,
 						"cash-settled swaptions not priced with G2 engine" );
 
-			// adjust the fixed rate of the swap for the spread on the
-			// floating leg (which is not taken into account by the
-			// model)
-			VanillaSwap swap = *arguments_.swap;
+			results_.value = model_->swaption( arguments_, fixedRate( arguments_, model_->termStructure() ) );
+		}
+
+		//! Prices the swaptions, e.g. those of the calibration helpers, by GeneralizedG2::swaptions
+		/*! The computations shared by the swaptions of the same expiry are done once per expiry,
+		instead of once per swaption through the engine.
+		*/
+		static void calculateGrid( const GeneralizedG2& model,
+								   const std::vector<shared_ptr<Swaption>>& swaptions,
+								   std::vector<Real>& values )
+		{
+			std::vector<Swaption::arguments> args( swaptions.size() );
+
+			for ( Size k = 0; k < swaptions.size(); k++ )
+			{
+				swaptions[k]->setupArguments( &args[k] );
+			}
+
+			calculateGrid( model, args, values );
+		}
+
+		//! Same as above on the arguments of the swaptions
+		static void calculateGrid( const GeneralizedG2& model,
+								   const std::vector<Swaption::arguments>& args,
+								   std::vector<Real>& values )
+		{
+			std::vector<Real> strikes( args.size() );
+
+			for ( Size k = 0; k < args.size(); k++ )
+			{
+				QL_REQUIRE( args[k].settlementType == Settlement::Physical,
+							"cash-settled swaptions not priced with G2 engine" );
+
+				strikes[k] = fixedRate( args[k], model.termStructure() );
+			}
+
+			model.swaptions( args, strikes, values );
+		}
+
+	private:
+		// adjust the fixed rate of the swap for the spread on the
+		// floating leg (which is not taken into account by the
+		// model)
+		static Rate fixedRate( const Swaption::arguments& arguments, const Handle<YieldTermStructure>& termStructure )
+		{
+			VanillaSwap swap = *arguments.swap;
 			swap.setPricingEngine( shared_ptr<PricingEngine>(
-				new DiscountingSwapEngine( model_->termStructure(), false ) ) );
+				new DiscountingSwapEngine( termStructure, false ) ) );
 			Spread correction = swap.spread() *
 				std::fabs( swap.floatingLegBPS() / swap.fixedLegBPS() );
-			Rate fixedRate = swap.fixedRate() - correction;
 
-			results_.value = model_->swaption( arguments_, fixedRate );
+			return swap.fixedRate() - correction;
 		}
 	};
+
+	//! Engine pricing a set of swaptions, e.g. those of the calibration helpers, as one grid
+	/*! The first of the swaptions calculated after the model changed prices the whole set by
+	GeneralizedG2SwaptionEngine::calculateGrid, and the others are answered from those values until
+	the next change, so that a calibration pays the computations shared per expiry once per step.
+	The swaptions are recognised by their underlying swap; any other swaption is priced alone.
+	*/
+	class GeneralizedG2SwaptionGridEngine : public GenericSwaptionEngine<GeneralizedG2>
+	{
+	public:
+		GeneralizedG2SwaptionGridEngine( const shared_ptr<GeneralizedG2>& model,
+										 const std::vector<shared_ptr<Swaption>>& swaptions )
+			: GenericSwaptionEngine<GeneralizedG2>( model )
+			, args_( swaptions.size() ), stale_( true )
+		{
+			// the arguments, and not the swaptions, are kept, since the swaptions hold this engine
+			for ( Size k = 0; k < swaptions.size(); k++ )
+			{
+				swaptions[k]->setupArguments( &args_[k] );
+				index_[args_[k].swap.get()] = k;
+			}
+		}
+
+		void calculate() const {
+
+			auto it = index_.find( arguments_.swap.get() );
+			if ( it == index_.end() )
+			{
+				std::vector<Real> value;
+				GeneralizedG2SwaptionEngine::calculateGrid( *model_, std::vector<Swaption::arguments>( 1, arguments_ ), value );
+
+				results_.value = value[0];
+				return;
+			}
+
+			if ( stale_ )
+			{
+				GeneralizedG2SwaptionEngine::calculateGrid( *model_, args_, values_ );
+				stale_ = false;
+			}
+
+			results_.value = values_[it->second];
+		}
+
+		//! The model or the term structure changed
+		void update() {
+			stale_ = true;
+			GenericSwaptionEngine<GeneralizedG2>::update();
+		}
+
+	private:
+		std::vector<Swaption::arguments> args_;
+		std::map<const VanillaSwap*, Size> index_;
+
+		mutable bool stale_;
+		mutable std::vector<Real> values_;
+	};
 }
 
 #endif // !HJCALIBRATOR_PRICINGENGINES_SWAPTION_GENERALG2SWAPTIONENGEIN_HPP
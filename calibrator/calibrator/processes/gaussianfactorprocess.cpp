@@ -0,0 +1,78 @@
+#include <calibrator/processes/gaussianfactorprocess.hpp>
+
+namespace HJCALIBRATOR
+{
+	GaussianFactorProcess::GaussianFactorProcess( const shared_ptr<GaussianFactorDynamics>& dynamics, const Array& x0 )
+		: dynamics_( dynamics ), x0_( x0 )
+	{
+		QL_REQUIRE( x0_.size() == dynamics_->dimension(),
+					"The initial values do not match the dimension of the dynamics." );
+	}
+
+	Size GaussianFactorProcess::size() const
+	{
+		return dynamics_->dimension();
+	}
+
+	Disposable<Array> GaussianFactorProcess::initialValues() const
+	{
+		Array x0 = x0_;
+		return x0;
+	}
+
+	Disposable<Array> GaussianFactorProcess::drift( Time t, const Array& x ) const
+	{
+		Array drift( size() );
+		for ( Size i = 0; i < size(); i++ )
+		{
+			drift[i] = -dynamics_->a( i, t ) * x[i];
+		}
+
+		return drift;
+	}
+
+	Disposable<Matrix> GaussianFactorProcess::diffusion( Time t, const Array& x ) const
+	{
+		Size n = size();
+
+		Matrix covariance( n, n );
+		for ( Size i = 0; i < n; i++ )
+		{
+			for ( Size j = 0; j <= i; j++ )
+			{
+				covariance[i][j] = covariance[j][i]
+					= dynamics_->rho( i, j, t ) * dynamics_->sigma( i, t ) * dynamics_->sigma( j, t );
+			}
+		}
+
+		Matrix diffusion = CholeskyDecomposition( covariance, true );
+		return diffusion;
+	}
+
+	Disposable<Array> GaussianFactorProcess::expectation( Time t0, const Array& x0, Time dt ) const
+	{
+		Array expectation( size() );
+		for ( Size i = 0; i < size(); i++ )
+		{
+			expectation[i] = x0[i] / dynamics_->E( i, t0, t0 + dt );
+		}
+
+		return expectation;
+	}
+
+	Disposable<Matrix> GaussianFactorProcess::stdDeviation( Time t0, const Array& x0, Time dt ) const
+	{
+		Matrix stdDeviation;
+		dynamics_->covarianceCholesky( t0, t0 + dt, stdDeviation );
+
+		return stdDeviation;
+	}
+
+	Disposable<Matrix> GaussianFactorProcess::covariance( Time t0, const Array& x0, Time dt ) const
+	{
+		Matrix covariance;
+		dynamics_->covariance( t0, t0 + dt, covariance );
+
+		return covariance;
+	}
+}
@@ -12,7 +12,7 @@ namespace HJCALIBRATOR
 		shared_ptr<GaussianFactorDynamics> dynamics_;
 
 	public:		
-		GaussianFactorProcess( shared_ptr<GaussianFactorDynamics> dynamics, Array x0 );
+		GaussianFactorProcess( const shared_ptr<GaussianFactorDynamics>& dynamics, const Array& x0 );
 
 		//! \name StochasticProcess interface
 		//@{
@@ -8,6 +8,7 @@
 #include <ql/math/integrals/kronrodintegral.hpp>
 
 #include <calibrator/global.hpp>
+#include <calibrator/models/parameters/integrableparameter.hpp>
 
 namespace HJCALIBRATOR
 {
@@ -18,15 +19,16 @@ namespace HJCALIBRATOR
 	dx(t) = -a(t)x(t)dt + \sigma(t)dW_t
 	\f]
 
-	\note The level(\f$ \mu \f$) is constrained to be zero,
-	and the speed term \f$ \alpha \f$ must be given as a IntegrableParameter object.
+	\note The level(\f$ \mu \f$) is constrained to be zero. When the speed term
+	\f$ \alpha \f$ is an IntegrableParameter, its integral is taken in closed form,
+	otherwise by quadrature.
 	
 	\ingroup processes
 	*/
 	class GeneralizedOrnsteinUhlenbeckProcess : public StochasticProcess1D
 	{
 	public :
-		GeneralizedOrnsteinUhlenbeckProcess( const Parameter& a, // must be an IntegrableParameter
+		GeneralizedOrnsteinUhlenbeckProcess( const Parameter& a, // integrated in closed form when an IntegrableParameter
 											 const Parameter& sigma,
 											 const Real x0 = 0 )
 			: a_(a), sigma_(sigma), x0_(x0)
@@ -45,11 +47,11 @@ namespace HJCALIBRATOR
 		Real stdDeviation( Time t0, Real x0, Time dt ) const override;
 		//@}
 
-		Parameter a() { return a_; }
-		Parameter sigma() { return sigma_; }
+		const Parameter& a() const { return a_; }
+		const Parameter& sigma() const { return sigma_; }
 
-		Real a( Time t ) { return a_( t ); }
-		Real sigma( Time t ) { return sigma_( t ); }
+		Real a( Time t ) const { return a_( t ); }
+		Real sigma( Time t ) const { return sigma_( t ); }
 
 	private :
 		Real E( Time t0, Time t1 ) const;
@@ -109,12 +111,18 @@ namespace HJCALIBRATOR
 	{
 		const Parameter& a = a_;
 
-		auto integrand = [&a]( Time u )
+		Real integral;
+		if ( !integrate( a, t0, t1, integral ) )
 		{
-			return a( u );
-		};
+			auto integrand = [&a]( Time u )
+			{
+				return a( u );
+			};
+
+			integral = integrator_( integrand, t0, t1 );
+		}
 
-		return integrator_( integrand, t0, t1 );
+		return exp( integral );
 	}
 
 	inline Real GeneralizedOrnsteinUhlenbeckProcess::VrIntegrand( Time t )
@@ -0,0 +1,598 @@
+// checks.cpp: checks and benchmarks of the calibrator run by "testbed check" and "testbed bench"
+//
+
+#include "stdafx.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <thread>
+
+#include <ql/discretizedasset.hpp>
+#include <ql/indexes/ibor/euribor.hpp>
+#include <ql/math/optimization/levenbergmarquardt.hpp>
+#include <ql/models/shortrate/calibrationhelpers/swaptionhelper.hpp>
+#include <ql/quotes/simplequote.hpp>
+#include <ql/termstructures/yield/flatforward.hpp>
+#include <ql/time/daycounters/actual365fixed.hpp>
+
+#include <calibrator/math/batchmath.hpp>
+#include <calibrator/math/integrals/gausslegendreintegral.hpp>
+#include <calibrator/models/shortrate/dynamics/fixedfactordynamics.hpp>
+#include <calibrator/models/shortrate/dynamics/piecewiseconstantintegrals.hpp>
+#include <calibrator/models/shortrate/dynamics/gaussianfactor/g++cmr_pcv.hpp>
+#include <calibrator/models/shortrate/twofactormodels/g2swaptionkernel.hpp>
+#include <calibrator/pricingengines/swaption/generalg2swaptionengine.hpp>
+
+#include "checks.h"
+
+using namespace QuantLib;
+using namespace std;
+using namespace HJCALIBRATOR;
+
+namespace
+{
+	//! Forward-mode dual number, a value and its derivative along one direction
+	/*! Just what the closed forms and the swaption kernel use, so that they run on it as on any
+	automatic differentiation type.
+	*/
+	struct Dual
+	{
+		Real value;
+		Real derivative;
+
+		Dual( Real value = 0.0, Real derivative = 0.0 )
+			: value( value ), derivative( derivative )
+		{}
+
+		Dual& operator+=( const Dual& y ) { value += y.value; derivative += y.derivative; return *this; }
+		Dual& operator-=( const Dual& y ) { value -= y.value; derivative -= y.derivative; return *this; }
+		Dual& operator*=( const Dual& y ) { derivative = derivative * y.value + value * y.derivative; value *= y.value; return *this; }
+		Dual& operator/=( const Dual& y ) { derivative = (derivative - value / y.value * y.derivative) / y.value; value /= y.value; return *this; }
+	};
+
+	Dual operator-( const Dual& x ) { return Dual( -x.value, -x.derivative ); }
+	Dual operator+( Dual x, const Dual& y ) { return x += y; }
+	Dual operator-( Dual x, const Dual& y ) { return x -= y; }
+	Dual operator*( Dual x, const Dual& y ) { return x *= y; }
+	Dual operator/( Dual x, const Dual& y ) { return x /= y; }
+
+	bool operator<( const Dual& x, const Dual& y ) { return x.value < y.value; }
+	bool operator>( const Dual& x, const Dual& y ) { return x.value > y.value; }
+
+	Dual exp( const Dual& x ) { Real e = std::exp( x.value ); return Dual( e, e * x.derivative ); }
+	Dual expm1( const Dual& x ) { return Dual( std::expm1( x.value ), std::exp( x.value ) * x.derivative ); }
+	Dual sqrt( const Dual& x ) { Real r = std::sqrt( x.value ); return Dual( r, 0.5 / r * x.derivative ); }
+	Dual fabs( const Dual& x ) { return x.value < 0.0 ? -x : x; }
+	Dual erfc( const Dual& x )
+	{
+		return Dual( std::erfc( x.value ), -M_2_SQRTPI * std::exp( -x.value * x.value ) * x.derivative );
+	}
+
+	//! Found by argument dependent lookup in the swaption kernel
+	Real passiveValue( const Dual& x ) { return x.value; }
+
+	//! The integrals on another scalar type, shifted by shift on the mean reversion or on every volatility of the factor
+	template <class T>
+	PiecewiseConstantIntegrals<T> shiftedIntegrals( const PiecewiseConstantIntegrals<Real>& integrals,
+													bool volatility, Size factor, const T& shift )
+	{
+		std::vector<T> a( integrals.a().begin(), integrals.a().end() );
+		std::vector<std::vector<T>> sigma, rho;
+
+		for ( const std::vector<Real>& values : integrals.sigma() )
+			sigma.emplace_back( values.begin(), values.end() );
+		for ( const std::vector<Real>& values : integrals.rho() )
+			rho.emplace_back( values.begin(), values.end() );
+
+		if ( volatility )
+		{
+			for ( T& value : sigma[factor] )
+				value += shift;
+		}
+		else
+		{
+			a[factor] += shift;
+		}
+
+		return PiecewiseConstantIntegrals<T>( a, integrals.nodes(), sigma, rho );
+	}
+
+	//! Expiry and fixed pay times of the swaption, as GeneralizedG2::swaption takes them
+	void swaptionTimes( const Handle<YieldTermStructure>& termStructure, const Swaption::arguments& arg,
+						Time& expiry, std::vector<Time>& payTimes )
+	{
+		Date settlement = termStructure->referenceDate();
+		DayCounter dayCounter = termStructure->dayCounter();
+
+		expiry = dayCounter.yearFraction( settlement, arg.floatingResetDates[0] );
+
+		payTimes.clear();
+		for ( const Date& date : arg.fixedPayDates )
+			payTimes.push_back( dayCounter.yearFraction( settlement, date ) );
+	}
+
+	//! GPPPCMRPCV on three factors, as G2PPPCMRPCV is on two
+	class G3PPPCMRPCV : public GPPPCMRPCV
+	{
+	public:
+		G3PPPCMRPCV( const Handle<YieldTermStructure>& termStructure,
+					 const RealVector& a,
+					 const std::vector<RealVector>& sigma_nodes,
+					 const std::vector<RealVector>& initial_sigma,
+					 const Matrix& rho )
+			: GaussianFactorDynamics( termStructure, RealVectorToParamVector( a, PositiveConstraint() ),
+									  convertParamVector( sigma_nodes, initial_sigma ), rho )
+			, GPPPCMRPCV( sigma_nodes )
+		{}
+
+	protected:
+		virtual GaussianFactorDynamics* clone() const override { return new G3PPPCMRPCV( *this ); }
+	};
+
+	//! Largest relative difference between FixedFactorDynamics and the dynamics it is built from
+	template <Size N>
+	Real fixedFactorError( const GaussianFactorDynamics& dynamics )
+	{
+		FixedFactorDynamics<N> fixed( dynamics );
+
+		Real error = 0.0;
+		auto compare = [&error]( Real value, Real reference )
+		{
+			error = std::max( error, std::fabs( value - reference ) / std::max( std::fabs( reference ), 1e-8 ) );
+		};
+
+		// from before the first node to past the last one, starting at 0 and within a segment
+		const Time intervals[][3] = { { 0.0, 1.0, 5.0 }, { 0.0, 5.0, 10.0 }, { 1.5, 7.0, 12.0 }, { 3.0, 9.5, 20.0 }, { 6.0, 15.0, 25.0 } };
+
+		GaussianFactorDynamics::Moments expected;
+		typename FixedFactorDynamics<N>::Moments moments;
+
+		for ( const auto& interval : intervals )
+		{
+			Time s = interval[0], t = interval[1], T = interval[2];
+
+			compare( fixed.A( t, T ), dynamics.A( t, T ) );
+			compare( fixed.variance( s, t ), dynamics.variance( s, t ) );
+
+			dynamics.moments( s, t, T, expected );
+			fixed.moments( s, t, T, moments );
+
+			for ( Size i = 0; i < N; i++ )
+			{
+				compare( fixed.B( i, t, T ), dynamics.B( i, t, T ) );
+				compare( moments.mean[i], expected.mean[i] );
+
+				for ( Size j = 0; j < N; j++ )
+				{
+					compare( fixed.variance( i, j, s, t ), dynamics.variance( i, j, s, t ) );
+					compare( moments.variance[i][j], expected.variance[i][j] );
+					compare( moments.integralVariance[i][j], expected.integralVariance[i][j] );
+					compare( moments.meanTforward[i][j], expected.meanTforward[i][j] );
+				}
+			}
+		}
+
+		return error;
+	}
+
+	//! A model with the CMRPCV dynamics of the testbed and the swaption helpers it calibrates to, on a curve of its own
+	struct CalibrationMarket
+	{
+		boost::shared_ptr<GeneralizedG2> model;
+		std::vector<boost::shared_ptr<CalibrationHelper>> helpers;
+		Array initialParams;
+	};
+
+	CalibrationMarket calibrationMarket( const Date& settlementDate, Rate rate,
+										 const std::vector<Period>& maturities,
+										 const std::vector<Period>& lengths,
+										 const std::vector<Volatility>& vols )
+	{
+		CalibrationMarket market;
+
+		Handle<YieldTermStructure> termStructure( boost::shared_ptr<YieldTermStructure>(
+			new FlatForward( settlementDate, rate, Actual365Fixed() ) ) );
+		boost::shared_ptr<IborIndex> index( new Euribor6M( termStructure ) );
+
+		std::vector<boost::shared_ptr<Swaption>> swaptions;
+		for ( Size i = 0; i < maturities.size(); i++ )
+		{
+			for ( Size j = 0; j < lengths.size(); j++ )
+			{
+				boost::shared_ptr<Quote> vol( new SimpleQuote( vols[i * lengths.size() + j] ) );
+				boost::shared_ptr<SwaptionHelper> helper( new SwaptionHelper( maturities[i], lengths[j],
+																			  Handle<Quote>( vol ),
+																			  index,
+																			  index->tenor(),
+																			  index->dayCounter(),
+																			  index->dayCounter(),
+																			  termStructure ) );
+				market.helpers.push_back( helper );
+				swaptions.push_back( helper->swaption() );
+			}
+		}
+
+		boost::shared_ptr<Gaussian2FactorDynamics> dynamics( new G2PPPCMRPCV( termStructure,
+																			  0.1, { 2,5,9.5 }, { 0.014,0.014,0.014,0.05 },
+																			  0.5, {}, { 0.01 },
+																			  -0.75 ) );
+		market.model.reset( new GeneralizedG2( dynamics ) );
+
+		boost::shared_ptr<PricingEngine> engine( new GeneralizedG2SwaptionGridEngine( market.model, swaptions ) );
+		for ( const boost::shared_ptr<CalibrationHelper>& helper : market.helpers )
+			helper->setPricingEngine( engine );
+
+		market.initialParams = market.model->params();
+
+		return market;
+	}
+
+	//! Calibrates the model of the market from its initial parameters, and returns the calibrated ones
+	Array calibrate( CalibrationMarket& market )
+	{
+		LevenbergMarquardt om;
+
+		market.model->setParams( market.initialParams );
+		market.model->calibrate( market.helpers, om, EndCriteria( 10000, 100, 1.0e-8, 1.0e-8, 1.0e-8 ) );
+
+		return market.model->params();
+	}
+}
+
+void swaptionArguments( const std::vector<boost::shared_ptr<CalibrationHelper>>& helpers,
+						std::vector<Swaption::arguments>& args,
+						std::vector<Real>& strikes )
+{
+	args.resize( helpers.size() );
+	strikes.resize( helpers.size() );
+
+	for ( Size k = 0; k < helpers.size(); k++ )
+	{
+		boost::shared_ptr<SwaptionHelper> helper = boost::dynamic_pointer_cast<SwaptionHelper>( helpers[k] );
+		QL_REQUIRE( helper, "The calibration helpers must be swaption helpers." );
+
+		// the floating leg has no spread, so that the strike is the fixed rate
+		helper->swaption()->setupArguments( &args[k] );
+		strikes[k] = helper->underlyingSwap()->fixedRate();
+	}
+}
+
+bool checkSwaptionWorkspace( const GeneralizedG2& model,
+							 const std::vector<Swaption::arguments>& args,
+							 const std::vector<Real>& strikes )
+{
+	const Size passes = 10;
+
+	// the first pass sizes the buffers on the longest swaption
+	for ( Size k = 0; k < args.size(); k++ )
+		model.swaption( args[k], strikes[k] );
+
+	Size growths = G2SwaptionWorkspace<Real>::growths();
+
+	for ( Size pass = 0; pass < passes; pass++ )
+	{
+		for ( Size k = 0; k < args.size(); k++ )
+			model.swaption( args[k], strikes[k] );
+	}
+
+	bool passed = G2SwaptionWorkspace<Real>::growths() == growths;
+
+	cout << "swaption workspace : " << G2SwaptionWorkspace<Real>::growths() - growths
+		<< " growths over " << passes * args.size() << " prices" << (passed ? "" : " FAILED") << endl;
+
+	return passed;
+}
+
+bool checkSwaptionGrid( GeneralizedG2& model,
+						const std::vector<Swaption::arguments>& args,
+						const std::vector<Real>& strikes )
+{
+	// the helpers come sorted by expiry, so that the reversed grid also checks the grouping
+	std::vector<Swaption::arguments> grid( args.rbegin(), args.rend() );
+	std::vector<Real> gridStrikes( strikes.rbegin(), strikes.rend() );
+
+	Size order = model.gaussHermiteOrder();
+
+	bool passed = true;
+	for ( Size mode : { Size( 0 ), Size( 16 ) } )
+	{
+		model.gaussHermiteOrder( mode );
+
+		std::vector<Real> values;
+		model.swaptions( grid, gridStrikes, values );
+
+		Real error = 0.0;
+		for ( Size k = 0; k < grid.size(); k++ )
+			error = std::max( error, std::fabs( values[k] / model.swaption( grid[k], gridStrikes[k] ) - 1.0 ) );
+
+		bool modePassed = error < 1e-12;
+
+		cout << "swaption grid, " << (mode == 0 ? "integrator" : "Gauss-Hermite") << " : relative error "
+			<< error << " to swaption()" << (modePassed ? "" : " FAILED") << endl;
+
+		passed = modePassed && passed;
+	}
+
+	model.gaussHermiteOrder( order );
+
+	return passed;
+}
+
+bool checkPiecewiseConstantIntegrals( const boost::shared_ptr<Gaussian2FactorDynamics>& dynamics,
+									  const std::vector<Swaption::arguments>& args,
+									  const std::vector<Real>& strikes )
+{
+	const Real significance = 10;
+	const GaussLegendreIntegral quadrature( 64 );
+
+	// both integrate the same conditional value by the same rule, so that they agree to the rounding
+	PiecewiseConstantIntegrals<Real> integrals( *dynamics );
+	GeneralizedG2 model( dynamics, significance, boost::make_shared<GaussLegendreIntegral>( quadrature ) );
+
+	Handle<YieldTermStructure> termStructure = dynamics->termStructure();
+
+	Real error = 0.0;
+	for ( Size k = 0; k < args.size(); k++ )
+	{
+		Time expiry;
+		std::vector<Time> payTimes;
+		swaptionTimes( termStructure, args[k], expiry, payTimes );
+
+		Real w = args[k].type == VanillaSwap::Payer ? 1 : -1;
+
+		Real kernel = g2Swaption( integrals, termStructure, expiry, payTimes,
+								  strikes[k], w, args[k].nominal, significance, quadrature );
+		Real price = model.swaption( args[k], strikes[k] );
+
+		error = std::max( error, std::fabs( kernel / price - 1.0 ) );
+	}
+
+	bool passed = error < 1e-10;
+
+	cout << "piecewise constant integrals : relative error " << error << " to the model"
+		<< (passed ? "" : " FAILED") << endl;
+
+	return passed;
+}
+
+bool checkFixedFactorDynamics( const Gaussian1FactorDynamics& g1,
+							   GeneralizedG2& g2,
+							   const std::vector<Swaption::arguments>& args,
+							   const std::vector<Real>& strikes )
+{
+	// the published copy is priced by the kernels of its family, the model itself by its fixed front end
+	g2.publish();
+	const Gaussian2FactorDynamics& frozen = *g2.published();
+
+	Matrix rho( 3, 3, 1.0 );
+	rho[0][1] = rho[1][0] = -0.75;
+	rho[0][2] = rho[2][0] = 0.3;
+	rho[1][2] = rho[2][1] = -0.2;
+
+	G3PPPCMRPCV g3( frozen.termStructure(), { 0.1, 0.5, 1.2 },
+					{ { 2, 5, 9.5 }, {}, { 3, 7 } },
+					{ { 0.014, 0.014, 0.014, 0.05 }, { 0.01 }, { 0.008, 0.012, 0.006 } },
+					rho );
+
+	Real errors[] = { fixedFactorError<1>( g1 ), fixedFactorError<2>( frozen ), fixedFactorError<3>( g3 ) };
+
+	Real swaptionError = 0.0;
+	for ( Size k = 0; k < args.size(); k++ )
+	{
+		Real price = g2.swaption( args[k], strikes[k] );
+		Real reference = g2.swaption( frozen, args[k], strikes[k] );
+
+		swaptionError = std::max( swaptionError, std::fabs( price / reference - 1.0 ) );
+	}
+
+	bool passed = *std::max_element( std::begin( errors ), std::end( errors ) ) < 1e-11 && swaptionError < 1e-10;
+
+	cout << "fixed factor dynamics : relative error " << errors[0] << ", " << errors[1] << " and " << errors[2]
+		<< " to the dynamics of 1, 2 and 3 factors, " << swaptionError << " on the swaptions"
+		<< (passed ? "" : " FAILED") << endl;
+
+	return passed;
+}
+
+bool checkSwaptionSensitivities( const boost::shared_ptr<Gaussian2FactorDynamics>& dynamics,
+								 const Swaption::arguments& arg,
+								 Real strike )
+{
+	const Real significance = 10;
+	const GaussLegendreIntegral quadrature( 64 );
+
+	Handle<YieldTermStructure> termStructure = dynamics->termStructure();
+
+	Time expiry;
+	std::vector<Time> payTimes;
+	swaptionTimes( termStructure, arg, expiry, payTimes );
+
+	Real w = arg.type == VanillaSwap::Payer ? 1 : -1;
+
+	PiecewiseConstantIntegrals<Real> integrals( *dynamics );
+
+	auto price = [&]( const auto& shifted )
+	{
+		return g2Swaption( shifted, termStructure, expiry, payTimes, strike, w, arg.nominal, significance, quadrature );
+	};
+
+	// the vega of the first factor, every volatility value moving together, and the sensitivity to its mean reversion
+	bool passed = true;
+	for ( bool volatility : { true, false } )
+	{
+		const Real h = volatility ? 1e-6 : 1e-5;
+
+		Real derivative = price( shiftedIntegrals( integrals, volatility, 0, Dual( 0.0, 1.0 ) ) ).derivative;
+		Real bumped = (price( shiftedIntegrals( integrals, volatility, 0, h ) )
+					   - price( shiftedIntegrals( integrals, volatility, 0, -h ) )) / (2 * h);
+
+		Real error = std::fabs( derivative / bumped - 1.0 );
+		bool sensitivityPassed = error < 1e-6;
+
+		cout << "swaption " << (volatility ? "vega" : "mean reversion sensitivity") << " : " << derivative
+			<< " on dual numbers, relative error " << error << " to the bumped prices"
+			<< (sensitivityPassed ? "" : " FAILED") << endl;
+
+		passed = sensitivityPassed && passed;
+	}
+
+	return passed;
+}
+
+bool checkBatchMath()
+{
+	const Size n = 100001;
+
+	// evenly spaced over the range of each bound, the strips having a remainder past the last pack
+	std::vector<Real> x( n ), y( n );
+
+	const Real ranges[][2] = { { -708.0, 709.0 }, { -2.0, 2.0 } };
+
+	Real expError = 0.0;
+	for ( const auto& range : ranges )
+	{
+		for ( Size k = 0; k < n; k++ )
+			x[k] = range[0] + (range[1] - range[0]) * k / (n - 1);
+
+		batchExp( x.data(), y.data(), n );
+
+		for ( Size k = 0; k < n; k++ )
+			expError = std::max( expError, std::fabs( y[k] / std::exp( x[k] ) - 1.0 ) );
+	}
+
+	Real cdfError = 0.0, cdfRelativeError = 0.0;
+	for ( Size k = 0; k < n; k++ )
+		x[k] = -37.0 + 74.0 * k / (n - 1);
+
+	batchNormalCdf( x.data(), y.data(), n );
+
+	for ( Size k = 0; k < n; k++ )
+	{
+		Real cdf = 0.5 * std::erfc( -x[k] * M_SQRT1_2 );
+
+		cdfError = std::max( cdfError, std::fabs( y[k] - cdf ) );
+		if ( x[k] < 0.0 )
+			cdfRelativeError = std::max( cdfRelativeError, std::fabs( y[k] / cdf - 1.0 ) );
+	}
+
+	bool passed = expError < 4e-16 && cdfError < 3e-16 && cdfRelativeError < 3e-13;
+
+	cout << "batch math : exp relative error " << expError
+		<< ", normal cdf error " << cdfError << " (relative " << cdfRelativeError << ")"
+		<< (passed ? "" : " FAILED") << endl;
+
+	return passed;
+}
+
+bool checkTreeDiscountBonds( const GeneralizedG1& g1, const GeneralizedG2& g2 )
+{
+	const Size stepsPerYear = 24;
+	const Time maturities[] = { 1.0, 5.0, 10.0 };
+
+	// the trees read phi off the grid instead of being fitted, so that they price the bonds of the curve
+	auto treePrice = []( const boost::shared_ptr<Lattice>& lattice, Time maturity )
+	{
+		DiscretizedDiscountBond bond;
+		bond.initialize( lattice, maturity );
+		bond.rollback( 0.0 );
+		return bond.presentValue();
+	};
+
+	Real error = 0.0, closedFormError = 0.0;
+	for ( Time maturity : maturities )
+	{
+		TimeGrid grid( maturity, Size( stepsPerYear * maturity ) );
+		DiscountFactor discount = g1.termStructure()->discount( maturity );
+
+		error = std::max( error, std::fabs( treePrice( g1.tree( grid ), maturity ) / discount - 1.0 ) );
+		closedFormError = std::max( closedFormError, std::fabs( g1.discountBond( 0.0, maturity, Array( 1, 0.0 ) ) / discount - 1.0 ) );
+
+		discount = g2.termStructure()->discount( maturity );
+
+		error = std::max( error, std::fabs( treePrice( g2.tree( grid ), maturity ) / discount - 1.0 ) );
+		closedFormError = std::max( closedFormError, std::fabs( g2.discountBond( 0.0, maturity, Array( 2, 0.0 ) ) / discount - 1.0 ) );
+	}
+
+	bool passed = error < 1e-3 && closedFormError < 1e-12;
+
+	cout << "tree discount bonds : relative error " << error << " to the curve, "
+		<< closedFormError << " for discountBond" << (passed ? "" : " FAILED") << endl;
+
+	return passed;
+}
+
+void benchmarkConcurrentCalibrations( const Date& settlementDate,
+									   const std::vector<Period>& maturities,
+									   const std::vector<Period>& lengths,
+									   const std::vector<Volatility>& vols,
+									   Size threads )
+{
+	// the markets are built beforehand, since the instruments register with the global evaluation date
+	std::vector<CalibrationMarket> markets;
+	for ( Size t = 0; t < threads; t++ )
+	{
+		std::vector<Volatility> marketVols( vols );
+		for ( Volatility& vol : marketVols )
+			vol *= 1.0 + 0.01 * t;
+
+		markets.push_back( calibrationMarket( settlementDate, 0.02224 + 0.001 * t, maturities, lengths, marketVols ) );
+	}
+
+	typedef std::chrono::steady_clock Clock;
+
+	std::vector<Array> serialParams( threads );
+	Clock::time_point begin = Clock::now();
+	for ( Size t = 0; t < threads; t++ )
+		serialParams[t] = calibrate( markets[t] );
+	double serialTime = std::chrono::duration<double>( Clock::now() - begin ).count();
+
+	std::vector<Array> concurrentParams( threads );
+	std::vector<std::string> errors( threads );
+	std::vector<std::thread> pool;
+
+	begin = Clock::now();
+	for ( Size t = 0; t < threads; t++ )
+	{
+		pool.emplace_back( [&, t]()
+		{
+			try
+			{
+				concurrentParams[t] = calibrate( markets[t] );
+			}
+			catch ( std::exception& e )
+			{
+				errors[t] = e.what();
+			}
+		} );
+	}
+	for ( std::thread& thread : pool )
+		thread.join();
+	double concurrentTime = std::chrono::duration<double>( Clock::now() - begin ).count();
+
+	Size differing = 0;
+	for ( Size t = 0; t < threads; t++ )
+	{
+		if ( !errors[t].empty() )
+			cout << "market " << t << " : " << errors[t] << endl;
+		else if ( !std::equal( serialParams[t].begin(), serialParams[t].end(),
+							   concurrentParams[t].begin(), concurrentParams[t].end() ) )
+			differing++;
+	}
+
+#if defined( CALIBRATOR_BY_VALUE_ACCESSORS )
+	cout << "parameter accessors : by value" << endl;
+#else
+	cout << "parameter accessors : by reference" << endl;
+#endif
+	cout << threads << " markets of " << maturities.size() * lengths.size() << " swaptions" << endl
+		<< "one after the other : " << serialTime << " s" << endl
+		<< "each on its own thread : " << concurrentTime << " s, "
+		<< serialTime / concurrentTime << " times the throughput on "
+		<< std::thread::hardware_concurrency() << " hardware threads" << endl;
+	if ( differing > 0 )
+		cout << differing << " markets calibrated DIFFERENTLY on their own thread" << endl;
+}
@@ -0,0 +1,59 @@
+// checks.h: checks and benchmarks of the calibrator run by "testbed check" and "testbed bench"
+//
+
+#pragma once
+
+#include <vector>
+
+#include <ql/models/calibrationhelper.hpp>
+
+#include <calibrator/models/shortrate/onefactormodels/generalg1.hpp>
+#include <calibrator/models/shortrate/twofactormodels/generalg2.hpp>
+
+//! Arguments and strikes of swaption helpers, as GeneralizedG2SwaptionEngine hands them to the model
+void swaptionArguments( const std::vector<boost::shared_ptr<QuantLib::CalibrationHelper>>& helpers,
+						std::vector<QuantLib::Swaption::arguments>& args,
+						std::vector<QuantLib::Real>& strikes );
+
+//! Prices the swaptions repeatedly and checks that the buffers of the thread no longer grow
+bool checkSwaptionWorkspace( const HJCALIBRATOR::GeneralizedG2& model,
+							 const std::vector<QuantLib::Swaption::arguments>& args,
+							 const std::vector<QuantLib::Real>& strikes );
+
+//! Checks GeneralizedG2::swaptions against swaption() value for value, by the integrator and by Gauss-Hermite
+bool checkSwaptionGrid( HJCALIBRATOR::GeneralizedG2& model,
+						const std::vector<QuantLib::Swaption::arguments>& args,
+						const std::vector<QuantLib::Real>& strikes );
+
+//! Checks that g2Swaption on the integrals of the dynamics agrees with GeneralizedG2 on the same rule
+bool checkPiecewiseConstantIntegrals( const boost::shared_ptr<HJCALIBRATOR::Gaussian2FactorDynamics>& dynamics,
+									  const std::vector<QuantLib::Swaption::arguments>& args,
+									  const std::vector<QuantLib::Real>& strikes );
+
+//! Checks FixedFactorDynamics against the dynamics of 1, 2 and 3 factors, and the swaptions the model prices on it
+bool checkFixedFactorDynamics( const HJCALIBRATOR::Gaussian1FactorDynamics& g1,
+							   HJCALIBRATOR::GeneralizedG2& g2,
+							   const std::vector<QuantLib::Swaption::arguments>& args,
+							   const std::vector<QuantLib::Real>& strikes );
+
+//! Checks the vega and the mean reversion sensitivity of g2Swaption on dual numbers against bumped prices
+bool checkSwaptionSensitivities( const boost::shared_ptr<HJCALIBRATOR::Gaussian2FactorDynamics>& dynamics,
+								 const QuantLib::Swaption::arguments& arg,
+								 QuantLib::Real strike );
+
+//! Checks batchExp and batchNormalCdf against std::exp and std::erfc within their documented bounds
+bool checkBatchMath();
+
+//! Prices zero-coupon bonds on the trees of the models and by discountBond against the term structure
+bool checkTreeDiscountBonds( const HJCALIBRATOR::GeneralizedG1& g1, const HJCALIBRATOR::GeneralizedG2& g2 );
+
+//! Times the calibration of one market per thread, first one after the other and then each on its own thread at once
+/*! Every market has its own term structure, helpers and GeneralizedG2 with the CMRPCV dynamics of the testbed, on
+a flat rate and volatilities shifted from market to market. With enough cores the concurrent run takes as long as one
+calibration unless the threads contend. Building the calibrator with CALIBRATOR_BY_VALUE_ACCESSORS gives the baseline.
+*/
+void benchmarkConcurrentCalibrations( const QuantLib::Date& settlementDate,
+									  const std::vector<QuantLib::Period>& maturities,
+									  const std::vector<QuantLib::Period>& lengths,
+									  const std::vector<QuantLib::Volatility>& vols,
+									  QuantLib::Size threads );